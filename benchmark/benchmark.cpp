@@ -0,0 +1,92 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+using std::vector;
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+namespace charls {
+namespace benchmark {
+
+namespace {
+
+double run_iterations(const benchmark_case& benchmark, const int64_t iterations)
+{
+    const auto start = steady_clock::now();
+    for (int64_t i = 0; i < iterations; ++i)
+    {
+        benchmark.run();
+    }
+
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+double median(vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 == 0 ? (values[middle - 1] + values[middle]) / 2 : values[middle];
+}
+
+} // namespace
+
+
+result run(const benchmark_case& benchmark, const options& options)
+{
+    // Warm up (caches, lazy initialization) and estimate the number of iterations that fill the minimum time.
+    int64_t iterations = 1;
+    for (;;)
+    {
+        const double seconds = run_iterations(benchmark, iterations);
+        if (seconds >= options.minimum_time_seconds || iterations >= (int64_t{1} << 30))
+            break;
+
+        const double factor = seconds > 0 ? options.minimum_time_seconds * 1.4 / seconds : 10;
+        iterations = std::max(iterations + 1, static_cast<int64_t>(static_cast<double>(iterations) * std::min(factor, 10.0)));
+    }
+
+    vector<double> nanoseconds_per_pixel(static_cast<size_t>(std::max(options.repetitions, 1)));
+    for (auto& value : nanoseconds_per_pixel)
+    {
+        value = run_iterations(benchmark, iterations) * 1e9 / (static_cast<double>(iterations) * static_cast<double>(benchmark.pixel_count));
+    }
+
+    const double mean = std::accumulate(nanoseconds_per_pixel.cbegin(), nanoseconds_per_pixel.cend(), 0.0) / static_cast<double>(nanoseconds_per_pixel.size());
+    double variance{};
+    for (const double value : nanoseconds_per_pixel)
+    {
+        variance += (value - mean) * (value - mean);
+    }
+    variance /= static_cast<double>(nanoseconds_per_pixel.size());
+
+    const double median_value = median(nanoseconds_per_pixel);
+    const double bytes_per_pixel = static_cast<double>(benchmark.byte_count) / static_cast<double>(benchmark.pixel_count);
+
+    return {benchmark.name, iterations, mean, median_value, mean > 0 ? std::sqrt(variance) * 100 / mean : 0,
+            bytes_per_pixel * 1e3 / median_value};
+}
+
+
+void print_header()
+{
+    std::printf("%-48s %12s %12s %10s %12s\n", "Benchmark", "ns/pixel", "MB/s", "stddev", "Iterations");
+    std::printf("%s\n", std::string(98, '-').c_str());
+}
+
+
+void print(const result& result)
+{
+    std::printf("%-48s %12.3f %12.1f %9.1f%% %12lld\n", result.name.c_str(), result.median_nanoseconds_per_pixel,
+                result.megabytes_per_second, result.standard_deviation_percent, static_cast<long long>(result.iterations));
+}
+
+}
+} // namespace charls::benchmark
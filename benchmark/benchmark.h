@@ -0,0 +1,68 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace charls {
+namespace benchmark {
+
+// Prevents that the compiler removes the computation of a value that is not used.
+template<typename T>
+void do_not_optimize(const T& value) noexcept
+{
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct options final
+{
+    std::string filter;
+    int repetitions{5};
+    double minimum_time_seconds{0.2};
+    uint32_t width{1024};
+    uint32_t height{1024};
+    std::vector<int> entropy_bits{0, 4, 8};
+};
+
+struct benchmark_case final
+{
+    std::string name;
+
+    // Number of pixels and bytes processed by a single call of run.
+    size_t pixel_count;
+    size_t byte_count;
+
+    std::function<void()> run;
+};
+
+struct result final
+{
+    std::string name;
+    int64_t iterations;
+    double mean_nanoseconds_per_pixel;
+    double median_nanoseconds_per_pixel;
+    double standard_deviation_percent;
+    double megabytes_per_second;
+};
+
+/// <summary>
+/// Runs the benchmark with as many iterations as needed to fill the minimum time, repeats this the requested number of times
+/// and computes the statistics of the repetitions.
+/// </summary>
+result run(const benchmark_case& benchmark, const options& options);
+
+void print_header();
+void print(const result& result);
+
+}
+} // namespace charls::benchmark
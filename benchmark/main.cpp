@@ -0,0 +1,498 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "benchmark.h"
+
+#include "../test/synthetic_image.h"
+
+#include "../src/color_transform.h"
+#include "../src/context.h"
+#include "../src/encoder_strategy.h"
+#include "../src/scan.h"
+
+#include <charls/charls.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::array;
+using std::cout;
+using std::string;
+using std::to_string;
+using std::vector;
+using namespace charls;
+using namespace charls::benchmark;
+
+namespace {
+
+constexpr int32_t context_count = 365;
+constexpr int32_t reset_threshold = 64;
+
+// Creates a gradient image with entropy_bits of noise added to every sample, with the generator of the test application.
+// An entropy of 0 creates a smooth gradient, higher values make the image less compressible.
+template<typename SampleType>
+vector<SampleType> create_image(const uint32_t width, const uint32_t height, const int32_t component_count, const int32_t bits_per_sample,
+                                const int32_t entropy_bits, const uint32_t seed)
+{
+    const vector<uint8_t> bytes{create_synthetic_image(synthetic_pattern::noise, width, height, bits_per_sample, component_count,
+                                                       std::min(entropy_bits, bits_per_sample), seed)};
+
+    vector<SampleType> image(bytes.size() / sizeof(SampleType));
+    std::memcpy(image.data(), bytes.data(), bytes.size());
+    return image;
+}
+
+int8_t quantize_gradient(const int32_t di) noexcept
+{
+    // Default thresholds for 8 bit lossless: T1 = 3, T2 = 7, T3 = 21.
+    if (di <= -21) return -4;
+    if (di <= -7) return -3;
+    if (di <= -3) return -2;
+    if (di < 0) return -1;
+    if (di == 0) return 0;
+    if (di < 3) return 1;
+    if (di < 7) return 2;
+    if (di < 21) return 3;
+
+    return 4;
+}
+
+// Computes the prediction error and the context index (as the JPEG-LS regular mode does) for all pixels of an 8 bit image.
+struct modeling_data final
+{
+    vector<int32_t> error_values;
+    vector<int32_t> context_indices;
+};
+
+modeling_data create_modeling_data(const vector<uint8_t>& image, const uint32_t width, const uint32_t height)
+{
+    modeling_data data;
+    for (uint32_t y = 1; y < height; ++y)
+    {
+        const uint8_t* previous_line = &image[static_cast<size_t>(y - 1) * width];
+        const uint8_t* current_line = &image[static_cast<size_t>(y) * width];
+        for (uint32_t x = 1; x < width - 1; ++x)
+        {
+            const int32_t ra = current_line[x - 1];
+            const int32_t rb = previous_line[x];
+            const int32_t rc = previous_line[x - 1];
+            const int32_t rd = previous_line[x + 1];
+
+            const int32_t qs = (quantize_gradient(rd - rb) * 9 + quantize_gradient(rb - rc)) * 9 + quantize_gradient(rc - ra);
+            data.context_indices.push_back(std::abs(qs));
+            data.error_values.push_back(static_cast<int8_t>(current_line[x] - get_predicted_value(ra, rb, rc)));
+        }
+    }
+
+    return data;
+}
+
+array<jls_context, context_count> create_contexts()
+{
+    array<jls_context, context_count> contexts;
+    contexts.fill(jls_context(4));
+    return contexts;
+}
+
+// Provides access to the bit stream functions of the encoder.
+class bit_stream_writer final : public encoder_strategy
+{
+public:
+    explicit bit_stream_writer(const frame_info& frame_info, const coding_parameters& parameters) noexcept :
+        encoder_strategy(frame_info, parameters)
+    {
+    }
+
+    void set_presets(const jpegls_pc_parameters&) noexcept(false) override
+    {
+    }
+
+    size_t encode_scan(std::unique_ptr<process_line>, byte_stream_info&) noexcept(false) override
+    {
+        return 0;
+    }
+
+    std::unique_ptr<process_line> create_process_line(byte_stream_info, uint32_t /*stride*/) noexcept(false) override
+    {
+        return nullptr;
+    }
+
+    void write(vector<uint8_t>& destination, const vector<std::pair<uint32_t, int32_t>>& codes)
+    {
+        byte_stream_info info{nullptr, destination.data(), destination.size()};
+        initialize(info);
+
+        for (const auto& code : codes)
+        {
+            append_to_bit_stream(code.first, code.second);
+        }
+
+        end_scan();
+    }
+};
+
+benchmark_case predicted_value_case(const string& suffix, const std::shared_ptr<vector<uint8_t>>& image, const uint32_t width, const uint32_t height)
+{
+    const size_t pixel_count = static_cast<size_t>(width - 1) * (height - 1);
+    return {"get_predicted_value" + suffix, pixel_count, pixel_count, [image, width, height] {
+                int32_t sum{};
+                for (uint32_t y = 1; y < height; ++y)
+                {
+                    const uint8_t* previous_line = &(*image)[static_cast<size_t>(y - 1) * width];
+                    const uint8_t* current_line = &(*image)[static_cast<size_t>(y) * width];
+                    for (uint32_t x = 1; x < width; ++x)
+                    {
+                        sum += get_predicted_value(current_line[x - 1], previous_line[x], previous_line[x - 1]);
+                    }
+                }
+                do_not_optimize(sum);
+            }};
+}
+
+// Quantizes the three local gradients with a lookup table and computes the context id, as the regular mode does per sample.
+benchmark_case context_id_case(const string& suffix, const std::shared_ptr<vector<uint8_t>>& image, const uint32_t width, const uint32_t height)
+{
+    constexpr int32_t range{256};
+    auto lut = std::make_shared<vector<int8_t>>(static_cast<size_t>(range) * 2);
+    for (int32_t i = -range; i < range; ++i)
+    {
+        (*lut)[static_cast<size_t>(i + range)] = quantize_gradient(i);
+    }
+
+    const size_t pixel_count = static_cast<size_t>(width - 2) * (height - 1);
+    return {"compute_context_id" + suffix, pixel_count, pixel_count, [image, lut, width, height] {
+                const int8_t* quantization = &(*lut)[range];
+                int32_t sum{};
+                for (uint32_t y = 1; y < height; ++y)
+                {
+                    const uint8_t* previous_line = &(*image)[static_cast<size_t>(y - 1) * width];
+                    const uint8_t* current_line = &(*image)[static_cast<size_t>(y) * width];
+                    for (uint32_t x = 1; x < width - 1; ++x)
+                    {
+                        const int32_t ra = current_line[x - 1];
+                        const int32_t rb = previous_line[x];
+                        const int32_t rc = previous_line[x - 1];
+                        const int32_t rd = previous_line[x + 1];
+                        sum += compute_context_id(quantization[rd - rb], quantization[rb - rc], quantization[rc - ra]);
+                    }
+                }
+                do_not_optimize(sum);
+            }};
+}
+
+benchmark_case update_variables_case(const string& suffix, const std::shared_ptr<modeling_data>& data)
+{
+    const size_t pixel_count = data->error_values.size();
+    return {"jls_context::update_variables" + suffix, pixel_count, pixel_count, [data] {
+                auto contexts = create_contexts();
+                for (size_t i = 0; i < data->error_values.size(); ++i)
+                {
+                    contexts[static_cast<size_t>(data->context_indices[i])].update_variables(data->error_values[i], 0, reset_threshold);
+                }
+                do_not_optimize(contexts);
+            }};
+}
+
+benchmark_case golomb_code_case(const string& suffix, const std::shared_ptr<modeling_data>& data)
+{
+    // Use the context state as it is after a pass over the image, to have realistic values for k.
+    auto contexts = std::make_shared<array<jls_context, context_count>>(create_contexts());
+    for (size_t i = 0; i < data->error_values.size(); ++i)
+    {
+        (*contexts)[static_cast<size_t>(data->context_indices[i])].update_variables(data->error_values[i], 0, reset_threshold);
+    }
+
+    const size_t pixel_count = data->error_values.size();
+    return {"jls_context::get_golomb_code" + suffix, pixel_count, pixel_count, [data, contexts] {
+                int32_t sum{};
+                for (const int32_t context_index : data->context_indices)
+                {
+                    sum += (*contexts)[static_cast<size_t>(context_index)].get_golomb_code();
+                }
+                do_not_optimize(sum);
+            }};
+}
+
+benchmark_case append_to_bit_stream_case(const string& suffix, const std::shared_ptr<modeling_data>& data)
+{
+    // Golomb code the mapped error values with the k of their context: unary prefix followed by the k low bits.
+    auto codes = std::make_shared<vector<std::pair<uint32_t, int32_t>>>();
+    auto contexts = create_contexts();
+    for (size_t i = 0; i < data->error_values.size(); ++i)
+    {
+        jls_context& context = contexts[static_cast<size_t>(data->context_indices[i])];
+        const int32_t k = context.get_golomb_code();
+        const int32_t error_value = data->error_values[i];
+        const auto mapped_error = static_cast<uint32_t>(error_value >= 0 ? 2 * error_value : -2 * error_value - 1);
+
+        const int32_t high_bits = std::min(static_cast<int32_t>(mapped_error >> k), 22);
+        codes->emplace_back(1U, high_bits + 1);
+        if (k != 0)
+        {
+            codes->emplace_back(mapped_error & ((1U << k) - 1), k);
+        }
+
+        context.update_variables(error_value, 0, reset_threshold);
+    }
+
+    const size_t pixel_count = data->error_values.size();
+    auto destination = std::make_shared<vector<uint8_t>>(pixel_count * 4 + 1024);
+    auto writer = std::make_shared<bit_stream_writer>(frame_info{}, coding_parameters{});
+    return {"encoder_strategy::append_to_bit_stream" + suffix, pixel_count, pixel_count, [codes, destination, writer] {
+                writer->write(*destination, *codes);
+                do_not_optimize(*destination);
+            }};
+}
+
+// Noise over all bits makes the image incompressible, the encoded size can then exceed estimated_destination_size.
+// A sample is coded with at most LIMIT bits and the encoder inserts at most 1 stuffing bit per 7 data bits.
+size_t maximum_destination_size(const frame_info& frame)
+{
+    const auto limit = static_cast<size_t>(2 * (frame.bits_per_sample + std::max(8, frame.bits_per_sample)));
+    const size_t bit_count = static_cast<size_t>(frame.width) * frame.height * static_cast<size_t>(frame.component_count) * limit;
+    return bit_count / 7 + 1024;
+}
+
+template<typename SampleType>
+void add_codec_cases(vector<benchmark_case>& cases, const string& name, const std::shared_ptr<vector<SampleType>>& image,
+                     const frame_info& frame, const interleave_mode interleave_mode, const int32_t near_lossless)
+{
+    const size_t pixel_count = static_cast<size_t>(frame.width) * frame.height;
+    const size_t byte_count = image->size() * sizeof(SampleType);
+
+    jpegls_encoder reference_encoder;
+    reference_encoder.frame_info(frame).interleave_mode(interleave_mode).near_lossless(near_lossless);
+
+    auto encoded = std::make_shared<vector<uint8_t>>(maximum_destination_size(frame));
+    reference_encoder.destination(*encoded);
+    encoded->resize(reference_encoder.encode(*image));
+
+    // The destinations are allocated once, to keep the allocation and clearing of the buffers out of the measurement.
+    auto encode_destination = std::make_shared<vector<uint8_t>>(maximum_destination_size(frame));
+    cases.push_back({"encode/" + name, pixel_count, byte_count, [image, encode_destination, frame, interleave_mode, near_lossless] {
+                         jpegls_encoder encoder;
+                         encoder.frame_info(frame).interleave_mode(interleave_mode).near_lossless(near_lossless);
+
+                         encoder.destination(*encode_destination);
+                         do_not_optimize(encoder.encode(*image));
+                     }});
+
+    auto decode_destination = std::make_shared<vector<uint8_t>>(byte_count);
+    cases.push_back({"decode/" + name, pixel_count, byte_count, [encoded, decode_destination] {
+                         jpegls_decoder decoder;
+                         decoder.source(*encoded).read_header();
+
+                         decoder.decode(*decode_destination);
+                         do_not_optimize(*decode_destination);
+                     }});
+}
+
+template<typename Transform>
+benchmark_case color_transform_case(const string& name, const std::shared_ptr<vector<uint8_t>>& image)
+{
+    const size_t pixel_count = image->size() / 3;
+    return {"color_transform/" + name, pixel_count, image->size(), [image] {
+                const Transform transform;
+                uint32_t sum{};
+                for (size_t i = 0; i < image->size(); i += 3)
+                {
+                    const triplet<uint8_t> pixel = transform((*image)[i], (*image)[i + 1], (*image)[i + 2]);
+                    sum += static_cast<uint32_t>(pixel.v1 + pixel.v2 + pixel.v3);
+                }
+                do_not_optimize(sum);
+            }};
+}
+
+template<typename Transform>
+benchmark_case inverse_color_transform_case(const string& name, const std::shared_ptr<vector<uint8_t>>& image)
+{
+    const size_t pixel_count = image->size() / 3;
+    return {"color_transform/" + name + " inverse", pixel_count, image->size(), [image] {
+                const typename Transform::inverse inverse{Transform()};
+                uint32_t sum{};
+                for (size_t i = 0; i < image->size(); i += 3)
+                {
+                    const triplet<uint8_t> pixel = inverse((*image)[i], (*image)[i + 1], (*image)[i + 2]);
+                    sum += static_cast<uint32_t>(pixel.v1 + pixel.v2 + pixel.v3);
+                }
+                do_not_optimize(sum);
+            }};
+}
+
+vector<benchmark_case> create_benchmark_cases(const options& options)
+{
+    const uint32_t width = options.width;
+    const uint32_t height = options.height;
+    vector<benchmark_case> cases;
+
+    for (const int32_t entropy_bits : options.entropy_bits)
+    {
+        const string suffix = "/entropy:" + to_string(entropy_bits);
+        const auto seed = static_cast<uint32_t>(entropy_bits) + 1;
+
+        const auto mono8 = std::make_shared<vector<uint8_t>>(create_image<uint8_t>(width, height, 1, 8, entropy_bits, seed));
+        const auto data = std::make_shared<modeling_data>(create_modeling_data(*mono8, width, height));
+
+        cases.push_back(predicted_value_case(suffix, mono8, width, height));
+        cases.push_back(context_id_case(suffix, mono8, width, height));
+        cases.push_back(update_variables_case(suffix, data));
+        cases.push_back(golomb_code_case(suffix, data));
+        cases.push_back(append_to_bit_stream_case(suffix, data));
+
+        add_codec_cases(cases, "mono 8 bit lossless" + suffix, mono8, {width, height, 8, 1}, interleave_mode::none, 0);
+        add_codec_cases(cases, "mono 8 bit near 2" + suffix, mono8, {width, height, 8, 1}, interleave_mode::none, 2);
+
+        const auto mono16 = std::make_shared<vector<uint16_t>>(create_image<uint16_t>(width, height, 1, 16, entropy_bits, seed));
+        add_codec_cases(cases, "mono 16 bit lossless" + suffix, mono16, {width, height, 16, 1}, interleave_mode::none, 0);
+
+        const auto rgb8 = std::make_shared<vector<uint8_t>>(create_image<uint8_t>(width, height, 3, 8, entropy_bits, seed));
+        add_codec_cases(cases, "rgb 8 bit lossless sample" + suffix, rgb8, {width, height, 8, 3}, interleave_mode::sample, 0);
+        add_codec_cases(cases, "rgb 8 bit lossless line" + suffix, rgb8, {width, height, 8, 3}, interleave_mode::line, 0);
+    }
+
+    // Flat blocks with noisy blocks in between, the flat blocks are coded in run mode.
+    const auto runs = std::make_shared<vector<uint8_t>>(create_synthetic_image(synthetic_pattern::flat_regions, width, height, 8, 1, 4, 1));
+    add_codec_cases(cases, "run mode", runs, {width, height, 8, 1}, interleave_mode::none, 0);
+
+    const auto rgb8 = std::make_shared<vector<uint8_t>>(create_image<uint8_t>(width, height, 3, 8, 8, 1));
+    cases.push_back(color_transform_case<transform_hp1<uint8_t>>("hp1", rgb8));
+    cases.push_back(inverse_color_transform_case<transform_hp1<uint8_t>>("hp1", rgb8));
+    cases.push_back(color_transform_case<transform_hp2<uint8_t>>("hp2", rgb8));
+    cases.push_back(inverse_color_transform_case<transform_hp2<uint8_t>>("hp2", rgb8));
+    cases.push_back(color_transform_case<transform_hp3<uint8_t>>("hp3", rgb8));
+    cases.push_back(inverse_color_transform_case<transform_hp3<uint8_t>>("hp3", rgb8));
+
+    return cases;
+}
+
+bool starts_with(const string& text, const char* prefix)
+{
+    return text.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+vector<int> parse_list(const string& text)
+{
+    vector<int> values;
+    std::istringstream stream(text);
+    for (string value; std::getline(stream, value, ',');)
+    {
+        values.push_back(std::stoi(value));
+    }
+
+    return values;
+}
+
+void print_usage()
+{
+    cout << "Usage: charls_benchmark [options]\n"
+            "  --filter=<text>       Only run the benchmarks whose name contains the text\n"
+            "  --list                Print the names of the benchmarks\n"
+            "  --repetitions=<n>     Number of measured repetitions (default 5)\n"
+            "  --min_time=<seconds>  Minimum duration of a single repetition (default 0.2)\n"
+            "  --size=<w>x<h>        Size of the synthetic images (default 1024x1024)\n"
+            "  --entropy=<n,...>     Bits of random noise in the synthetic images (default 0,4,8)\n";
+}
+
+} // namespace
+
+
+int main(const int argc, const char* const argv[])
+try
+{
+    options options;
+    bool list{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string argument{argv[i]};
+        if (starts_with(argument, "--filter="))
+        {
+            options.filter = argument.substr(9);
+        }
+        else if (argument == "--list")
+        {
+            list = true;
+        }
+        else if (starts_with(argument, "--repetitions="))
+        {
+            options.repetitions = std::stoi(argument.substr(14));
+        }
+        else if (starts_with(argument, "--min_time="))
+        {
+            options.minimum_time_seconds = std::stod(argument.substr(11));
+        }
+        else if (starts_with(argument, "--size="))
+        {
+            const auto separator = argument.find('x', 7);
+            if (separator == string::npos)
+            {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+            options.width = static_cast<uint32_t>(std::stoul(argument.substr(7, separator - 7)));
+            options.height = static_cast<uint32_t>(std::stoul(argument.substr(separator + 1)));
+        }
+        else if (starts_with(argument, "--entropy="))
+        {
+            options.entropy_bits = parse_list(argument.substr(10));
+        }
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (std::any_of(options.entropy_bits.cbegin(), options.entropy_bits.cend(), [](const int bits) { return bits < 0 || bits > 16; }))
+    {
+        cout << "The entropy must be between 0 and 16 bits\n";
+        return EXIT_FAILURE;
+    }
+
+    if (options.width < 3 || options.height < 2)
+    {
+        cout << "The image size must be at least 3x2\n";
+        return EXIT_FAILURE;
+    }
+
+#ifndef NDEBUG
+    cout << "NOTE: running benchmarks in debug mode, performance may be slow!\n";
+#endif
+
+    const vector<benchmark_case> cases = create_benchmark_cases(options);
+
+    if (!list)
+    {
+        cout << "Image size " << options.width << "x" << options.height << ", " << options.repetitions << " repetitions\n";
+        print_header();
+    }
+
+    for (const auto& benchmark_case : cases)
+    {
+        if (!options.filter.empty() && benchmark_case.name.find(options.filter) == string::npos)
+            continue;
+
+        if (list)
+        {
+            cout << benchmark_case.name << "\n";
+            continue;
+        }
+
+        print(run(benchmark_case, options));
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (const std::exception& error)
+{
+    std::cerr << "charls_benchmark failed: " << error.what() << "\n";
+    return EXIT_FAILURE;
+}
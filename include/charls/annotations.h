@@ -12,6 +12,7 @@
 #define IN_ _In_
 #define IN_OPT_ _In_opt_
 #define IN_Z_ _In_z_
+#define IN_READS_(size) _In_reads_(size)
 #define IN_READS_BYTES_(size) _In_reads_bytes_(size)
 #define OUT_ _Out_
 #define OUT_OPT_ _Out_opt_
@@ -24,6 +25,7 @@
 #define IN_
 #define IN_OPT_
 #define IN_Z_
+#define IN_READS_(size)
 #define IN_READS_BYTES_(size)
 #define OUT_
 #define OUT_OPT_
@@ -53,6 +53,20 @@ charls_get_version_string(void) CHARLS_NOEXCEPT;
 CHARLS_API_IMPORT_EXPORT void CHARLS_API_CALLING_CONVENTION
 charls_get_version_number(OUT_OPT_ int32_t* major, OUT_OPT_ int32_t* minor, OUT_OPT_ int32_t* patch) CHARLS_NOEXCEPT;
 
+/// <summary>
+/// Sets the functions that are used to allocate and free the internal objects and buffers of all encoder and decoder instances,
+/// for example to use a pooled allocator. Pass null pointers for both functions to restore the default (operator new and delete).
+/// The functions are process wide: set them before any encoder or decoder is created and don't change them while instances exist.
+/// </summary>
+/// <param name="allocate_function">Function that is called to allocate memory.</param>
+/// <param name="free_function">Function that is called to free memory.</param>
+/// <param name="user_context">Value that is passed to both functions.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_set_allocator(IN_OPT_ charls_allocate_function allocate_function,
+                     IN_OPT_ charls_free_function free_function,
+                     IN_OPT_ void* user_context) CHARLS_NOEXCEPT;
+
 
 /// <summary>
 /// Creates a JPEG-LS decoder instance, when finished with the instance destroy it with the function charls_jpegls_decoder_destroy.
@@ -81,6 +95,21 @@ charls_jpegls_decoder_set_source_buffer(IN_ charls_jpegls_decoder* decoder,
                                         IN_READS_BYTES_(source_size_bytes) const void* source_buffer,
                                         size_t source_size_bytes) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Set the references to the segments of a source that is not stored in one contiguous buffer (scatter-gather), for example
+/// the fragments of DICOM encapsulated pixel data. The segments are decoded in place as if they were concatenated,
+/// segment boundaries may be at any position, including inside markers.
+/// The data of the segments needs to remain valid until the stream is fully decoded, the segment array is copied.
+/// </summary>
+/// <param name="decoder">Reference to the decoder instance.</param>
+/// <param name="segments">Reference to an array of segments.</param>
+/// <param name="segment_count">Number of segments in the array.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_source_segments(IN_ charls_jpegls_decoder* decoder,
+                                          IN_READS_(segment_count) const charls_buffer_segment* segments,
+                                          size_t segment_count) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
 /// <summary>
 /// Tries to read the SPIFF header from the source buffer.
 /// If a SPIFF header exists its content will be put into the spiff_header parameter and header_found will be set to 1.
@@ -174,6 +203,34 @@ charls_jpegls_decoder_get_destination_size(IN_ const charls_jpegls_decoder* deco
                                            uint32_t stride,
                                            OUT_ size_t* destination_size_bytes) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Returns the size in bytes of a workspace that can hold all the memory (codec state, line buffers and lookup tables)
+/// that the decoder needs to decode a frame with the passed parameters.
+/// </summary>
+/// <param name="frame_info">The information of the frame to decode.</param>
+/// <param name="interleave_mode">The interleave mode of the scans of the frame.</param>
+/// <param name="workspace_size_bytes">Output argument, will hold the required size when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_workspace_size(IN_ const charls_frame_info* frame_info,
+                                         charls_interleave_mode interleave_mode,
+                                         OUT_ size_t* workspace_size_bytes) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Set a caller-provided memory block that is used as workspace by charls_jpegls_decoder_decode_to_buffer instead of
+/// allocating memory. Decoding fails with not_enough_memory when the workspace is smaller than the size returned by
+/// charls_jpegls_decoder_get_workspace_size. The workspace needs to remain valid until the decoder instance is destroyed.
+/// Pass a null pointer and a size of zero to decode with allocated memory again.
+/// </summary>
+/// <param name="decoder">Reference to the decoder instance.</param>
+/// <param name="workspace_buffer">Reference to the start of the memory block.</param>
+/// <param name="workspace_size_bytes">Size of the memory block in bytes.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_workspace(IN_ charls_jpegls_decoder* decoder,
+                                    OUT_WRITES_BYTES_(workspace_size_bytes) void* workspace_buffer,
+                                    size_t workspace_size_bytes) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull(1)));
+
 /// <summary>
 /// Will decode the JPEG-LS byte stream from the source buffer into the destination buffer.
 /// </summary>
@@ -191,6 +248,60 @@ charls_jpegls_decoder_decode_to_buffer(IN_ const charls_jpegls_decoder* decoder,
                                        size_t destination_size_bytes,
                                        uint32_t stride) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Configures if the decoder should collect statistics about how the scans are coded. The default is false.
+/// Collecting the statistics makes the decoding slightly slower.
+/// </summary>
+/// <param name="decoder">Reference to the decoder instance.</param>
+/// <param name="collect">true to collect the statistics during the next decode call.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_collect_scan_statistics(IN_ charls_jpegls_decoder* decoder,
+                                                  bool collect) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Returns the statistics of a decoded scan.
+/// </summary>
+/// <remarks>
+/// Function should be called after calling the function charls_jpegls_decoder_decode_to_buffer with collecting of the statistics enabled.
+/// </remarks>
+/// <param name="decoder">Reference to the decoder instance.</param>
+/// <param name="scan_index">Index of the scan. For interleave mode none this is the component index, otherwise 0.</param>
+/// <param name="scan_statistics">Output argument, will hold the statistics of the scan when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_scan_statistics(IN_ const charls_jpegls_decoder* decoder,
+                                          int32_t scan_index,
+                                          OUT_ charls_scan_statistics* scan_statistics) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Returns the time spent in the stages of the source buffer that is being decoded.
+/// </summary>
+/// <remarks>
+/// The times are only measured when the library is built with the CMake option CHARLS_TIMING, otherwise the function fails with
+/// CHARLS_JPEGLS_ERRC_INVALID_OPERATION.
+/// </remarks>
+/// <param name="decoder">Reference to the decoder instance.</param>
+/// <param name="timing_statistics">Output argument, will hold the measured times when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_timing_statistics(IN_ const charls_jpegls_decoder* decoder,
+                                            OUT_ charls_timing_statistics* timing_statistics) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Reads the frame and scan parameters from the header of a JPEG-LS byte stream, without creating a decoder instance.
+/// Only the header segments up to and including the first start of scan segment are parsed, the source can be a prefix
+/// of the encoded data. No memory is allocated.
+/// </summary>
+/// <param name="source_buffer">Reference to the start of the source buffer.</param>
+/// <param name="source_size_bytes">Size of the source buffer in bytes.</param>
+/// <param name="probe_info">Output argument, will hold the parameters from the header when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_probe(IN_READS_BYTES_(source_size_bytes) const void* source_buffer,
+                    size_t source_size_bytes,
+                    OUT_ charls_probe_info* probe_info) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
 
 /// <summary>
 /// Creates a JPEG-LS encoder instance, when finished with the instance destroy it with the function charls_jpegls_encoder_destroy.
@@ -262,6 +373,34 @@ CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_encoder_set_color_transformation(IN_ charls_jpegls_encoder* encoder,
                                                charls_color_transformation color_transformation) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Configures if the encoder should select the color transformation and the preset coding parameters (T1, T2, T3 and RESET) that
+/// result in the best compression. The default is false.
+/// When enabled, the encoder trial encodes strips of the image (about 1/16 of the rows) with candidate parameters before encoding
+/// the complete image. The configured color transformation and preset coding parameters are used as starting point.
+/// The interleave mode is not changed, as it defines the layout of the source and decoded image.
+/// </summary>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="enable">true to select the coding parameters during the next encode call.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_auto_coding_parameters(IN_ charls_jpegls_encoder* encoder,
+                                                 bool enable) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Configures if the encoder should write the bit stream on a second thread. The default is false.
+/// When enabled, the calling thread computes the code words (the modeling stage) and passes them in batches to a worker
+/// thread that packs them into bytes. The encoded bit stream is identical to the bit stream created without a pipeline.
+/// This can reduce the encoding time on systems with more than one core, at the cost of an extra thread per encode call.
+/// A destination handler set with charls_jpegls_encoder_set_destination_handler is then also called from the worker thread.
+/// </summary>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="enable">true to use a pipeline of 2 threads during the next encode calls.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_pipelined_encoding(IN_ charls_jpegls_encoder* encoder,
+                                             bool enable) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
 /// <summary>
 /// Returns the size in bytes, that the encoder expects are needed to hold the encoded image.
 /// </summary>
@@ -288,6 +427,23 @@ charls_jpegls_encoder_set_destination_buffer(IN_ charls_jpegls_encoder* encoder,
                                              OUT_WRITES_BYTES_(destination_size_bytes) void* destination_buffer,
                                              size_t destination_size_bytes) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Set a function that provides the destination as a chain of buffers, which are requested when needed during the encoding.
+/// This avoids the allocation of one buffer for the worst case size. All buffers except the last are filled completely,
+/// the total number of bytes can be retrieved with charls_jpegls_encoder_get_bytes_written.
+/// The buffers need to remain valid during the encoding process.
+/// When pipelined encoding is enabled, the handler is called for the scan data from the internal thread that writes the
+/// bit stream, and for the other segments from the calling thread. The calls never overlap.
+/// </summary>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="handler">Function that is called to get the next destination buffer.</param>
+/// <param name="user_context">Value that is passed to the handler.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_destination_handler(IN_ charls_jpegls_encoder* encoder,
+                                              IN_ charls_destination_buffer_handler handler,
+                                              IN_OPT_ void* user_context) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull(1, 2)));
+
 /// <summary>
 /// Writes a standard SPIFF header to the destination. The additional values are computed from the current encoder settings.
 /// A SPIFF header is optional, but recommended for standalone JPEG-LS files.
@@ -359,6 +515,46 @@ CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_encoder_get_bytes_written(IN_ const charls_jpegls_encoder* encoder,
                                         OUT_ size_t* bytes_written) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
 
+/// <summary>
+/// Configures if the encoder should collect statistics about how the scans are coded. The default is false.
+/// Collecting the statistics makes the encoding slightly slower.
+/// </summary>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="collect">true to collect the statistics during the next encode call.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_collect_scan_statistics(IN_ charls_jpegls_encoder* encoder,
+                                                  bool collect) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Returns the statistics of an encoded scan.
+/// </summary>
+/// <remarks>
+/// Function should be called after calling the function charls_jpegls_encoder_encode_from_buffer with collecting of the statistics enabled.
+/// </remarks>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="scan_index">Index of the scan. For interleave mode none this is the component index, otherwise 0.</param>
+/// <param name="scan_statistics">Output argument, will hold the statistics of the scan when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_get_scan_statistics(IN_ const charls_jpegls_encoder* encoder,
+                                          int32_t scan_index,
+                                          OUT_ charls_scan_statistics* scan_statistics) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
+/// <summary>
+/// Returns the time spent in the stages of the last encode call.
+/// </summary>
+/// <remarks>
+/// The times are only measured when the library is built with the CMake option CHARLS_TIMING, otherwise the function fails with
+/// CHARLS_JPEGLS_ERRC_INVALID_OPERATION.
+/// </remarks>
+/// <param name="encoder">Reference to the encoder instance.</param>
+/// <param name="timing_statistics">Output argument, will hold the measured times when the function returns.</param>
+/// <returns>The result of the operation: success or a failure code.</returns>
+CHARLS_API_IMPORT_EXPORT charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_get_timing_statistics(IN_ const charls_jpegls_encoder* encoder,
+                                            OUT_ charls_timing_statistics* timing_statistics) CHARLS_NOEXCEPT CHARLS_ATTRIBUTE((nonnull));
+
 
 // Note: The 4 methods below are considered obsolete and will be removed in the next major update.
 
@@ -435,6 +631,18 @@ CHARLS_API_IMPORT_EXPORT CharlsApiResultType CHARLS_API_CALLING_CONVENTION JpegL
 
 namespace charls {
 
+/// <summary>
+/// Sets the functions that are used to allocate and free the internal objects and buffers of all encoder and decoder instances.
+/// Pass null pointers for both functions to restore the default (operator new and delete).
+/// </summary>
+/// <param name="allocate">Function that is called to allocate memory.</param>
+/// <param name="free">Function that is called to free memory.</param>
+/// <param name="user_context">Value that is passed to both functions.</param>
+inline void set_allocator(IN_OPT_ const allocate_function allocate, IN_OPT_ const free_function free, IN_OPT_ void* user_context = nullptr)
+{
+    check_jpegls_errc(charls_set_allocator(allocate, free, user_context));
+}
+
 /// <summary>
 /// JPEG-LS decoder class that encapsulates the C ABI interface calls and provide a native C++ interface.
 /// </summary>
@@ -465,6 +673,31 @@ class jpegls_decoder final
         return std::make_pair(decoder.frame_info(), decoder.interleave_mode());
     }
 
+    /// <summary>
+    /// Reads the frame and scan parameters from the header of a JPEG-LS byte stream, without creating a decoder instance.
+    /// The source can be a prefix of the encoded data, that contains the header segments up to the first start of scan segment.
+    /// </summary>
+    /// <param name="source_buffer">Reference to the start of the source buffer.</param>
+    /// <param name="source_size_bytes">Size of the source buffer in bytes.</param>
+    /// <returns>The parameters of the frame and the first scan.</returns>
+    CHARLS_NO_DISCARD static probe_info probe(IN_READS_BYTES_(source_size_bytes) const void* source_buffer, const size_t source_size_bytes)
+    {
+        probe_info info;
+        check_jpegls_errc(charls_jpegls_probe(source_buffer, source_size_bytes, &info));
+        return info;
+    }
+
+    /// <summary>
+    /// Reads the frame and scan parameters from the header of a JPEG-LS byte stream, without creating a decoder instance.
+    /// </summary>
+    /// <param name="source_container">A STL like container that provides the functions data() and size() and the type value_type.</param>
+    /// <returns>The parameters of the frame and the first scan.</returns>
+    template<typename Container, typename ValueType = typename Container::value_type>
+    CHARLS_NO_DISCARD static probe_info probe(const Container& source_container)
+    {
+        return probe(source_container.data(), source_container.size() * sizeof(ValueType));
+    }
+
     jpegls_decoder() = default;
 
     /// <summary>
@@ -508,6 +741,28 @@ class jpegls_decoder final
         return source(source_container.data(), source_container.size() * sizeof(ValueType));
     }
 
+    /// <summary>
+    /// Set the references to the segments of a source that is not stored in one contiguous buffer (scatter-gather).
+    /// The data of the segments needs to remain valid until the stream is fully decoded.
+    /// </summary>
+    /// <param name="segments">Reference to an array of segments.</param>
+    /// <param name="segment_count">Number of segments in the array.</param>
+    jpegls_decoder& source_segments(IN_READS_(segment_count) const buffer_segment* segments, const size_t segment_count)
+    {
+        check_jpegls_errc(charls_jpegls_decoder_set_source_segments(decoder_.get(), segments, segment_count));
+        return *this;
+    }
+
+    /// <summary>
+    /// Set the references to the segments of a source that is not stored in one contiguous buffer (scatter-gather).
+    /// </summary>
+    /// <param name="segments">A STL like container of buffer_segment items that provides the functions data() and size().</param>
+    template<typename Container>
+    jpegls_decoder& source_segments(const Container& segments)
+    {
+        return source_segments(segments.data(), segments.size());
+    }
+
     /// <summary>
     /// Tries to read the SPIFF header from the JPEG-LS stream.
     /// If a SPIFF header exists its will be returned otherwise the struct will be filled with default values.
@@ -622,6 +877,31 @@ class jpegls_decoder final
         return size_in_bytes;
     }
 
+    /// <summary>
+    /// Returns the size in bytes of a workspace that can hold all the memory that is needed to decode a frame.
+    /// </summary>
+    /// <param name="info">The information of the frame to decode.</param>
+    /// <param name="interleave_mode">The interleave mode of the scans of the frame.</param>
+    /// <returns>The required size in bytes of the workspace.</returns>
+    CHARLS_NO_DISCARD static size_t workspace_size(const charls::frame_info& info, const charls::interleave_mode interleave_mode)
+    {
+        size_t size_in_bytes;
+        check_jpegls_errc(charls_jpegls_decoder_get_workspace_size(&info, interleave_mode, &size_in_bytes));
+        return size_in_bytes;
+    }
+
+    /// <summary>
+    /// Set a caller-provided memory block that is used as workspace while decoding, instead of allocating memory.
+    /// The workspace needs to remain valid until the decoder instance is destroyed.
+    /// </summary>
+    /// <param name="workspace_buffer">Reference to the start of the memory block.</param>
+    /// <param name="workspace_size_bytes">Size of the memory block in bytes.</param>
+    jpegls_decoder& workspace(OUT_WRITES_BYTES_(workspace_size_bytes) void* workspace_buffer, const size_t workspace_size_bytes)
+    {
+        check_jpegls_errc(charls_jpegls_decoder_set_workspace(decoder_.get(), workspace_buffer, workspace_size_bytes));
+        return *this;
+    }
+
     /// <summary>
     /// Will decode the JPEG-LS byte stream set with source into the destination buffer.
     /// </summary>
@@ -658,6 +938,41 @@ class jpegls_decoder final
         return destination;
     }
 
+    /// <summary>
+    /// Configures if the decoder should collect statistics about how the scans are coded.
+    /// </summary>
+    /// <param name="collect">true to collect the statistics during the next decode call.</param>
+    jpegls_decoder& collect_scan_statistics(const bool collect = true)
+    {
+        check_jpegls_errc(charls_jpegls_decoder_set_collect_scan_statistics(decoder_.get(), collect));
+        return *this;
+    }
+
+    /// <summary>
+    /// Returns the statistics of a decoded scan.
+    /// Function can be called after decode, when collecting the scan statistics was enabled.
+    /// </summary>
+    /// <param name="scan_index">Index of the scan. For interleave mode none this is the component index, otherwise 0.</param>
+    /// <returns>The statistics of the scan.</returns>
+    CHARLS_NO_DISCARD charls::scan_statistics scan_statistics(const int32_t scan_index = 0) const
+    {
+        charls::scan_statistics scan_statistics;
+        check_jpegls_errc(charls_jpegls_decoder_get_scan_statistics(decoder_.get(), scan_index, &scan_statistics));
+        return scan_statistics;
+    }
+
+    /// <summary>
+    /// Returns the time spent in the stages of the header parsing and decoding.
+    /// Only available when the library is built with the CMake option CHARLS_TIMING.
+    /// </summary>
+    /// <returns>The measured times.</returns>
+    CHARLS_NO_DISCARD charls::timing_statistics timing_statistics() const
+    {
+        charls::timing_statistics timing_statistics;
+        check_jpegls_errc(charls_jpegls_decoder_get_timing_statistics(decoder_.get(), &timing_statistics));
+        return timing_statistics;
+    }
+
 private:
     CHARLS_NO_DISCARD static charls_jpegls_decoder* create_decoder()
     {
@@ -771,6 +1086,28 @@ class jpegls_encoder final
         return *this;
     }
 
+    /// <summary>
+    /// Configures if the encoder should select the color transformation and the preset coding parameters that result in the
+    /// best compression, by trial encoding strips of the image with candidate parameters.
+    /// </summary>
+    /// <param name="enable">true to select the coding parameters during the next encode call.</param>
+    jpegls_encoder& auto_coding_parameters(const bool enable = true)
+    {
+        check_jpegls_errc(charls_jpegls_encoder_set_auto_coding_parameters(encoder_.get(), enable));
+        return *this;
+    }
+
+    /// <summary>
+    /// Configures if the encoder should write the bit stream on a second thread, while the calling thread does the modeling.
+    /// A destination handler is then also called from this second thread.
+    /// </summary>
+    /// <param name="enable">true to use a pipeline of 2 threads during the next encode calls.</param>
+    jpegls_encoder& pipelined_encoding(const bool enable = true)
+    {
+        check_jpegls_errc(charls_jpegls_encoder_set_pipelined_encoding(encoder_.get(), enable));
+        return *this;
+    }
+
     /// <summary>
     /// Returns the size in bytes, that the encoder expects are needed to hold the encoded image.
     /// </summary>
@@ -809,6 +1146,19 @@ class jpegls_encoder final
         return destination(destination_container.data(), destination_container.size() * sizeof(ValueType));
     }
 
+    /// <summary>
+    /// Set a function that provides the destination as a chain of buffers, which are requested when needed during the encoding.
+    /// All buffers except the last are filled completely, encode returns the total number of bytes.
+    /// With pipelined encoding the handler is also called from the internal thread that writes the bit stream, never concurrently.
+    /// </summary>
+    /// <param name="handler">Function that is called to get the next destination buffer.</param>
+    /// <param name="user_context">Value that is passed to the handler.</param>
+    jpegls_encoder& destination_handler(IN_ destination_buffer_handler handler, IN_OPT_ void* user_context = nullptr)
+    {
+        check_jpegls_errc(charls_jpegls_encoder_set_destination_handler(encoder_.get(), handler, user_context));
+        return *this;
+    }
+
     /// <summary>
     /// Writes a standard SPIFF header to the destination. The additional values are computed from the current encoder settings.
     /// </summary>
@@ -895,6 +1245,41 @@ class jpegls_encoder final
         return bytes_written;
     }
 
+    /// <summary>
+    /// Configures if the encoder should collect statistics about how the scans are coded.
+    /// </summary>
+    /// <param name="collect">true to collect the statistics during the next encode call.</param>
+    jpegls_encoder& collect_scan_statistics(const bool collect = true)
+    {
+        check_jpegls_errc(charls_jpegls_encoder_set_collect_scan_statistics(encoder_.get(), collect));
+        return *this;
+    }
+
+    /// <summary>
+    /// Returns the statistics of an encoded scan.
+    /// Function can be called after encode, when collecting the scan statistics was enabled.
+    /// </summary>
+    /// <param name="scan_index">Index of the scan. For interleave mode none this is the component index, otherwise 0.</param>
+    /// <returns>The statistics of the scan.</returns>
+    CHARLS_NO_DISCARD charls::scan_statistics scan_statistics(const int32_t scan_index = 0) const
+    {
+        charls::scan_statistics scan_statistics;
+        check_jpegls_errc(charls_jpegls_encoder_get_scan_statistics(encoder_.get(), scan_index, &scan_statistics));
+        return scan_statistics;
+    }
+
+    /// <summary>
+    /// Returns the time spent in the stages of the last encode call.
+    /// Only available when the library is built with the CMake option CHARLS_TIMING.
+    /// </summary>
+    /// <returns>The measured times.</returns>
+    CHARLS_NO_DISCARD charls::timing_statistics timing_statistics() const
+    {
+        charls::timing_statistics timing_statistics;
+        check_jpegls_errc(charls_jpegls_encoder_get_timing_statistics(encoder_.get(), &timing_statistics));
+        return timing_statistics;
+    }
+
 private:
     CHARLS_NO_DISCARD static charls_jpegls_encoder* create_encoder()
     {
@@ -930,6 +1315,7 @@ class jpegls_encoder final
 #undef IN_
 #undef IN_OPT_
 #undef IN_Z_
+#undef IN_READS_
 #undef IN_READS_BYTES_
 #undef OUT_
 #undef OUT_OPT_
@@ -31,6 +31,20 @@ inline byte_stream_info from_byte_array_const(const void* bytes, const std::size
     return from_byte_array(const_cast<void*>(bytes), count);
 }
 
+//
+// stream_read_options controls how the compressed data is read from a rawStream source.
+// buffer_size: the size of the blocks that are read from the stream, 0 selects the default (64 KiB).
+// read_ahead: read the next block on a helper thread while the current block is decoded, this overlaps
+//             the I/O with the decoding when the stream is slow (for example a network backed stream).
+// Note: the decoder can read up to 2 blocks beyond the end of the encoded data from the stream.
+struct stream_read_options final
+{
+    std::size_t buffer_size;
+    bool read_ahead;
+};
+
+
 CHARLS_API_IMPORT_EXPORT charls::jpegls_errc JpegLsEncodeStream(byte_stream_info destination, size_t& bytes_written, byte_stream_info source, const JlsParameters& params);
 CHARLS_API_IMPORT_EXPORT charls::jpegls_errc JpegLsDecodeStream(byte_stream_info destination, byte_stream_info source, const JlsParameters* params);
+CHARLS_API_IMPORT_EXPORT charls::jpegls_errc JpegLsDecodeStream(byte_stream_info destination, byte_stream_info source, const JlsParameters* params, const stream_read_options& options);
 CHARLS_API_IMPORT_EXPORT charls::jpegls_errc JpegLsReadHeaderStream(byte_stream_info source, JlsParameters* params);
@@ -16,6 +16,7 @@ namespace charls {
 namespace impl {
 
 #else
+#include <stddef.h>
 #include <stdint.h>
 #endif
 
@@ -812,6 +813,32 @@ struct charls_frame_info CHARLS_FINAL
     int32_t component_count;
 };
 
+/// <summary>
+/// Defines the parameters of a JPEG-LS image that are stored in its header segments: the frame and the first scan.
+/// </summary>
+struct charls_probe_info CHARLS_FINAL
+{
+    /// <summary>
+    /// Information about the frame: the dimensions, the bits per sample and the component count.
+    /// </summary>
+    struct charls_frame_info frame_info;
+
+    /// <summary>
+    /// The near-lossless value of the first scan, 0 means lossless.
+    /// </summary>
+    int32_t near_lossless;
+
+    /// <summary>
+    /// The interleave mode of the first scan.
+    /// </summary>
+    charls_interleave_mode interleave_mode;
+
+    /// <summary>
+    /// The color transformation of the HP color transform segment, none when the segment is not present.
+    /// </summary>
+    charls_color_transformation color_transformation;
+};
+
 /// <summary>
 /// Defines the JPEG-LS preset coding parameters as defined in ISO/IEC 14495-1, C.2.4.1.1.
 /// JPEG-LS defines a default set of parameters, but custom parameters can be used.
@@ -846,6 +873,120 @@ struct charls_jpegls_pc_parameters CHARLS_FINAL
     int32_t reset_value;
 };
 
+/// <summary>
+/// Statistics about how a scan was encoded or decoded. Can be used to select the coding parameters and interleave mode based on data.
+/// </summary>
+/// <remark>
+/// In interleave mode sample, a run covers all the components of a pixel: run mode samples are counted per component and
+/// a run interruption is counted once per pixel.
+/// </remark>
+struct charls_scan_statistics CHARLS_FINAL
+{
+    /// <summary>
+    /// Number of samples coded in regular mode.
+    /// </summary>
+    uint64_t regular_mode_sample_count;
+
+    /// <summary>
+    /// Number of samples coded in run mode, excluding the samples that interrupted a run.
+    /// </summary>
+    uint64_t run_mode_sample_count;
+
+    /// <summary>
+    /// Number of runs that ended with a run interruption sample (runs that end at the end of a line are not counted).
+    /// </summary>
+    uint64_t run_interruption_count;
+
+    /// <summary>
+    /// Number of mapped error values that exceeded the code length limit and were coded with the escape code.
+    /// </summary>
+    uint64_t escape_code_count;
+
+    /// <summary>
+    /// Number of 0xFF bytes in the coded data. Every 0xFF byte is followed by a stuffed 0 bit to prevent marker emulation.
+    /// </summary>
+    uint64_t stuffed_bit_count;
+
+    /// <summary>
+    /// Number of times the A, B and N variables of a regular mode context were halved after reaching the reset value.
+    /// </summary>
+    uint64_t context_reset_count;
+
+    /// <summary>
+    /// Histogram of the Golomb coding parameter k used to code the regular mode samples, indexed by k.
+    /// </summary>
+    uint64_t golomb_parameter_count[32];
+};
+
+/// <summary>
+/// Wall time spent in the stages of an encode or decode call, in nanoseconds.
+/// Only measured when the library is built with the CMake option CHARLS_TIMING.
+/// </summary>
+struct charls_timing_statistics CHARLS_FINAL
+{
+    /// <summary>
+    /// Time spent parsing the JPEG-LS header and the start of scan segments (decoder only).
+    /// </summary>
+    uint64_t read_header_nanoseconds;
+
+    /// <summary>
+    /// Time spent creating the codecs, this includes the initialization of the lookup tables.
+    /// </summary>
+    uint64_t create_codec_nanoseconds;
+
+    /// <summary>
+    /// Time spent encoding or decoding the scans. Includes the time reported in process_line_nanoseconds.
+    /// </summary>
+    uint64_t scan_nanoseconds;
+
+    /// <summary>
+    /// Time spent copying lines from or to the caller's buffer, this includes color transformations and byte swapping.
+    /// </summary>
+    uint64_t process_line_nanoseconds;
+};
+
+/// <summary>
+/// Describes one segment of a source that is not stored in a single contiguous buffer (scatter-gather), for example the
+/// fragments of DICOM encapsulated pixel data. The segments are decoded in place, as if they were concatenated.
+/// </summary>
+struct charls_buffer_segment CHARLS_FINAL
+{
+    /// <summary>
+    /// Reference to the first byte of the segment.
+    /// </summary>
+    const void* data;
+
+    /// <summary>
+    /// Size of the segment in bytes, empty segments are allowed.
+    /// </summary>
+    size_t size;
+};
+
+/// <summary>
+/// Function called by the encoder when the current buffer of a chain of destination buffers is full, for example to write
+/// directly into pooled fixed-size blocks, DICOM fragments or network frames. All buffers except the last are filled completely.
+/// With pipelined encoding the function can be called from an internal thread of the encoder.
+/// </summary>
+/// <param name="user_context">The user context that was passed together with the function.</param>
+/// <param name="buffer_size">Output argument, will hold the size in bytes of the returned buffer.</param>
+/// <returns>Reference to the next buffer, or a null pointer to stop the encoding (reported as destination_buffer_too_small).</returns>
+typedef void*(CHARLS_API_CALLING_CONVENTION* charls_destination_buffer_handler)(void* user_context, size_t* buffer_size);
+
+/// <summary>
+/// Function called by CharLS to allocate memory for its internal objects and buffers.
+/// </summary>
+/// <param name="user_context">The user context that was passed together with the function.</param>
+/// <param name="size">The number of bytes to allocate.</param>
+/// <returns>Reference to memory aligned as by malloc, or a null pointer when the memory cannot be allocated.</returns>
+typedef void*(CHARLS_API_CALLING_CONVENTION* charls_allocate_function)(void* user_context, size_t size);
+
+/// <summary>
+/// Function called by CharLS to free memory that was allocated with the matching charls_allocate_function.
+/// </summary>
+/// <param name="user_context">The user context that was passed together with the function.</param>
+/// <param name="pointer">Reference to the memory to free, never a null pointer.</param>
+typedef void(CHARLS_API_CALLING_CONVENTION* charls_free_function)(void* user_context, void* pointer);
+
 /// <summary>
 /// Defines the JPEG-LS preset coding parameters as defined in ISO/IEC 14495-1, C.2.4.1.1.
 /// JPEG-LS defines a default set of parameters, but custom parameters can be used.
@@ -1009,11 +1150,22 @@ namespace charls {
 
 using spiff_header = charls_spiff_header;
 using frame_info = charls_frame_info;
+using probe_info = charls_probe_info;
 using jpegls_pc_parameters = charls_jpegls_pc_parameters;
+using scan_statistics = charls_scan_statistics;
+using timing_statistics = charls_timing_statistics;
+using buffer_segment = charls_buffer_segment;
+using destination_buffer_handler = charls_destination_buffer_handler;
+using allocate_function = charls_allocate_function;
+using free_function = charls_free_function;
 
 static_assert(sizeof(spiff_header) == 40, "size of struct is incorrect, check padding settings");
 static_assert(sizeof(frame_info) == 16, "size of struct is incorrect, check padding settings");
+static_assert(sizeof(probe_info) == 28, "size of struct is incorrect, check padding settings");
 static_assert(sizeof(jpegls_pc_parameters) == 20, "size of struct is incorrect, check padding settings");
+static_assert(sizeof(scan_statistics) == 304, "size of struct is incorrect, check padding settings");
+static_assert(sizeof(timing_statistics) == 32, "size of struct is incorrect, check padding settings");
+static_assert(sizeof(buffer_segment) == 2 * sizeof(void*), "size of struct is incorrect, check padding settings");
 
 } // namespace charls
 
@@ -1021,6 +1173,10 @@ static_assert(sizeof(jpegls_pc_parameters) == 20, "size of struct is incorrect,
 
 typedef struct charls_spiff_header charls_spiff_header;
 typedef struct charls_frame_info charls_frame_info;
+typedef struct charls_probe_info charls_probe_info;
 typedef struct charls_jpegls_pc_parameters charls_jpegls_pc_parameters;
+typedef struct charls_scan_statistics charls_scan_statistics;
+typedef struct charls_timing_statistics charls_timing_statistics;
+typedef struct charls_buffer_segment charls_buffer_segment;
 
 #endif
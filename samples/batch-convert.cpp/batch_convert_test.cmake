@@ -0,0 +1,61 @@
+# Copyright (c) Team CharLS.
+# SPDX-License-Identifier: BSD-3-Clause
+
+# Tests the batch-convert application, run with:
+# cmake -DBATCH_CONVERT=<executable> -DTEST_IMAGES=<directory> -DINVALID_IMAGE=<file> -DWORK_DIRECTORY=<directory> -P batch_convert_test.cmake
+
+function(run_batch_convert expected_result)
+  execute_process(COMMAND "${BATCH_CONVERT}" ${ARGN} -q RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE errors)
+  if(expected_result STREQUAL "success" AND NOT result EQUAL 0)
+    message(FATAL_ERROR "batch-convert ${ARGN} failed (${result}): ${errors}")
+  endif()
+  if(expected_result STREQUAL "failure" AND result EQUAL 0)
+    message(FATAL_ERROR "batch-convert ${ARGN} succeeded, a failure was expected")
+  endif()
+endfunction()
+
+file(REMOVE_RECURSE "${WORK_DIRECTORY}")
+file(COPY "${TEST_IMAGES}/TEST8.PPM" "${TEST_IMAGES}/TEST16.PGM" DESTINATION "${WORK_DIRECTORY}/input")
+
+# Encoding and decoding must reproduce the input files, the color image is coded with every interleave mode.
+foreach(interleave_mode none line sample)
+  set(directory "${WORK_DIRECTORY}/${interleave_mode}")
+  run_batch_convert(success encode -i ${interleave_mode} -j 2 -o "${directory}/encoded" "${WORK_DIRECTORY}/input")
+  run_batch_convert(success decode -o "${directory}/decoded" "${directory}/encoded")
+
+  foreach(name TEST8.PPM TEST16.PGM)
+    string(REGEX REPLACE "\\.(PPM|PGM)$" "" base_name ${name})
+    string(TOLOWER ${CMAKE_MATCH_1} extension)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E compare_files "${WORK_DIRECTORY}/input/${name}" "${directory}/decoded/${base_name}.${extension}"
+                    RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+      message(FATAL_ERROR "${name} changed after encoding and decoding with interleave mode ${interleave_mode}")
+    endif()
+  endforeach()
+endforeach()
+
+# Invalid input files must be reported and must not leave an output file behind.
+set(invalid_directory "${WORK_DIRECTORY}/invalid")
+set(output_directory "${WORK_DIRECTORY}/invalid_output")
+file(WRITE "${invalid_directory}/width_out_of_range.pgm" "P5\n4294967296 1\n255\n0")
+file(WRITE "${invalid_directory}/maximum_value_out_of_range.pgm" "P5\n1 1\n65536\n00")
+file(WRITE "${invalid_directory}/pixel_data_too_small.pgm" "P5\n16 16\n255\n0123456789")
+run_batch_convert(failure encode -o "${output_directory}" "${invalid_directory}")
+
+# The entropy coded data of this file is invalid: decoding fails after the output file is created.
+file(COPY "${INVALID_IMAGE}" DESTINATION "${invalid_directory}")
+run_batch_convert(failure decode -o "${output_directory}" "${invalid_directory}")
+
+# Input files that map to the same output file are rejected before any file is converted.
+file(COPY "${TEST_IMAGES}/TEST16.PGM" DESTINATION "${invalid_directory}/a")
+file(COPY "${TEST_IMAGES}/TEST16.PGM" DESTINATION "${invalid_directory}/b")
+run_batch_convert(failure encode -o "${output_directory}" "${invalid_directory}/a/TEST16.PGM" "${invalid_directory}/b/TEST16.PGM")
+file(COPY "${TEST_IMAGES}/TEST8.PPM" DESTINATION "${invalid_directory}/c")
+file(COPY "${TEST_IMAGES}/TEST16.PGM" DESTINATION "${invalid_directory}/c")
+file(RENAME "${invalid_directory}/c/TEST16.PGM" "${invalid_directory}/c/TEST8.PGM")
+run_batch_convert(failure encode "${invalid_directory}/c")
+
+file(GLOB output_files "${output_directory}/*" "${invalid_directory}/c/*.jls")
+if(output_files)
+  message(FATAL_ERROR "Failed conversions left output files: ${output_files}")
+endif()
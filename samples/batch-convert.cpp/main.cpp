@@ -0,0 +1,645 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Converts batches of files between the PNM (P5/P6) and the JPEG-LS format on a pool of worker threads.
+// Inputs can be files, directories (searched recursively) and file lists (@file, one path per line).
+// The output file of a conversion that fails is removed.
+
+#include "../common/memory_mapped_file.h"
+
+#include <charls/charls.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+
+using std::string;
+using std::vector;
+
+enum class operation
+{
+    encode,
+    decode
+};
+
+struct options final
+{
+    operation mode;
+    vector<string> inputs;
+    string output_directory;
+    unsigned int thread_count{std::max(1U, std::thread::hardware_concurrency())};
+    charls::interleave_mode interleave_mode{charls::interleave_mode::line};
+    int near_lossless{};
+    bool quiet{};
+
+    options(const int argc, char** argv)
+    {
+        if (argc < 3)
+            throw std::runtime_error(usage);
+
+        if (strcmp(argv[1], "encode") == 0)
+        {
+            mode = operation::encode;
+        }
+        else if (strcmp(argv[1], "decode") == 0)
+        {
+            mode = operation::decode;
+        }
+        else
+        {
+            throw std::runtime_error(usage);
+        }
+
+        for (int i = 2; i < argc; ++i)
+        {
+            const string argument{argv[i]};
+            if (argument == "-o" || argument == "-j" || argument == "-i" || argument == "-n")
+            {
+                if (i + 1 == argc)
+                    throw std::runtime_error("Missing value for option " + argument + "\n");
+
+                const char* value{argv[++i]};
+                if (argument == "-o")
+                {
+                    output_directory = value;
+                }
+                else if (argument == "-j")
+                {
+                    thread_count = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+                    if (thread_count == 0)
+                        throw std::runtime_error("Option -j needs to be 1 or more\n");
+                }
+                else if (argument == "-i")
+                {
+                    interleave_mode = string_to_interleave_mode(value);
+                }
+                else
+                {
+                    near_lossless = static_cast<int>(strtol(value, nullptr, 10));
+                    if (near_lossless < 0 || near_lossless > 255)
+                        throw std::runtime_error("Option -n needs to be in the range [0,255]\n");
+                }
+            }
+            else if (argument == "-q")
+            {
+                quiet = true;
+            }
+            else
+            {
+                inputs.push_back(argument);
+            }
+        }
+
+        if (inputs.empty())
+            throw std::runtime_error(usage);
+    }
+
+private:
+    static constexpr const char* usage{
+        "Usage: encode|decode [options] <input>...\n"
+        "  input: a file, a directory (searched recursively) or @file with one path per line\n"
+        "  -o <directory>  write the output files into this directory, default is next to the input files\n"
+        "  -j <count>      number of worker threads, default is the number of hardware threads\n"
+        "  -i <mode>       interleave mode when encoding color images (none, line or sample), default = line\n"
+        "  -n <value>      near-lossless value when encoding, default = 0 (lossless)\n"
+        "  -q              only report failures and the summary\n"};
+
+    static charls::interleave_mode string_to_interleave_mode(const char* argument)
+    {
+        if (strcmp(argument, "none") == 0)
+            return charls::interleave_mode::none;
+
+        if (strcmp(argument, "line") == 0)
+            return charls::interleave_mode::line;
+
+        if (strcmp(argument, "sample") == 0)
+            return charls::interleave_mode::sample;
+
+        throw std::runtime_error("Option -i needs to be: none, line or sample\n");
+    }
+};
+
+constexpr const char* options::usage;
+
+
+struct conversion_job final
+{
+    string input_path;
+    string output_path; // Without extension, the extension depends on the content when decoding.
+};
+
+struct conversion_result final
+{
+    string output_path;
+    size_t input_size;
+    size_t output_size;
+    size_t pixel_data_size;
+};
+
+
+bool has_extension(const string& path, const char* extension)
+{
+    const size_t length{strlen(extension)};
+    if (path.size() < length)
+        return false;
+
+    return std::equal(path.end() - static_cast<std::ptrdiff_t>(length), path.end(), extension,
+                      [](const char a, const char b) { return tolower(static_cast<unsigned char>(a)) == b; });
+}
+
+bool is_input_file(const string& path, const operation mode)
+{
+    if (mode == operation::encode)
+        return has_extension(path, ".pgm") || has_extension(path, ".ppm") || has_extension(path, ".pnm");
+
+    return has_extension(path, ".jls");
+}
+
+string remove_extension(const string& path)
+{
+    const size_t dot{path.find_last_of('.')};
+    const size_t separator{path.find_last_of("/\\")};
+    if (dot == string::npos || (separator != string::npos && dot < separator))
+        return path;
+
+    return path.substr(0, dot);
+}
+
+bool is_directory(const string& path)
+{
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 && (status.st_mode & S_IFMT) == S_IFDIR;
+}
+
+vector<string> read_directory(const string& directory)
+{
+    vector<string> names;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA find_data;
+    const HANDLE find_handle{FindFirstFileA((directory + "\\*").c_str(), &find_data)};
+    if (find_handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot read directory " + directory);
+
+    do
+    {
+        names.emplace_back(find_data.cFileName);
+    } while (FindNextFileA(find_handle, &find_data));
+    FindClose(find_handle);
+#else
+    DIR* dir{opendir(directory.c_str())};
+    if (!dir)
+        throw std::runtime_error("Cannot read directory " + directory);
+
+    while (const dirent* entry = readdir(dir))
+    {
+        names.emplace_back(entry->d_name);
+    }
+    closedir(dir);
+#endif
+
+    names.erase(std::remove_if(names.begin(), names.end(), [](const string& name) { return name == "." || name == ".."; }), names.end());
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Adds the files in a directory tree, their output path mirrors the tree below the directory.
+void add_directory(const string& directory, const string& relative_path, const options& options, vector<conversion_job>& jobs)
+{
+    for (const auto& name : read_directory(directory))
+    {
+        const string path{directory + '/' + name};
+        if (is_directory(path))
+        {
+            add_directory(path, relative_path + name + '/', options, jobs);
+        }
+        else if (is_input_file(name, options.mode))
+        {
+            const string output{options.output_directory.empty() ? path : options.output_directory + '/' + relative_path + name};
+            jobs.push_back({path, remove_extension(output)});
+        }
+    }
+}
+
+void add_file(const string& path, const options& options, vector<conversion_job>& jobs)
+{
+    if (options.output_directory.empty())
+    {
+        jobs.push_back({path, remove_extension(path)});
+        return;
+    }
+
+    const size_t separator{path.find_last_of("/\\")};
+    const string name{separator == string::npos ? path : path.substr(separator + 1)};
+    jobs.push_back({path, remove_extension(options.output_directory + '/' + name)});
+}
+
+// Two jobs with the same output path would write the same file at the same time (for example foo.pgm and foo.ppm, or
+// a/x.pgm and b/x.pgm from a file list with -o). This is rejected before any conversion starts.
+void check_unique_output_paths(const vector<conversion_job>& jobs)
+{
+    vector<const conversion_job*> sorted_jobs;
+    sorted_jobs.reserve(jobs.size());
+    for (const auto& job : jobs)
+    {
+        sorted_jobs.push_back(&job);
+    }
+    std::sort(sorted_jobs.begin(), sorted_jobs.end(),
+              [](const conversion_job* a, const conversion_job* b) { return a->output_path < b->output_path; });
+
+    const auto duplicate = std::adjacent_find(sorted_jobs.begin(), sorted_jobs.end(),
+                                              [](const conversion_job* a, const conversion_job* b) { return a->output_path == b->output_path; });
+    if (duplicate != sorted_jobs.end())
+        throw std::runtime_error("Input files " + (*duplicate)->input_path + " and " + (*(duplicate + 1))->input_path +
+                                 " have the same output file " + (*duplicate)->output_path + ".*");
+}
+
+vector<conversion_job> create_jobs(const options& options)
+{
+    vector<conversion_job> jobs;
+
+    for (const auto& input : options.inputs)
+    {
+        if (input[0] == '@')
+        {
+            std::ifstream list{input.substr(1)};
+            if (!list)
+                throw std::runtime_error("Cannot open file list " + input.substr(1));
+
+            string path;
+            while (std::getline(list, path))
+            {
+                if (!path.empty() && path.back() == '\r')
+                {
+                    path.pop_back();
+                }
+
+                if (!path.empty())
+                {
+                    add_file(path, options, jobs);
+                }
+            }
+        }
+        else if (is_directory(input))
+        {
+            add_directory(input, string{}, options, jobs);
+        }
+        else
+        {
+            add_file(input, options, jobs);
+        }
+    }
+
+    check_unique_output_paths(jobs);
+    return jobs;
+}
+
+void create_parent_directories(const string& path)
+{
+    for (size_t separator{path.find_first_of("/\\", 1)}; separator != string::npos; separator = path.find_first_of("/\\", separator + 1))
+    {
+        const string directory{path.substr(0, separator)};
+#ifdef _WIN32
+        const int result{_mkdir(directory.c_str())};
+#else
+        const int result{mkdir(directory.c_str(), 0777)};
+#endif
+        if (result != 0 && errno != EEXIST)
+            throw std::system_error(errno, std::generic_category(), "Cannot create directory " + directory);
+    }
+}
+
+
+// Parses the header of a binary PNM file: P5 or P6, width, height and maximum value, separated by whitespace or comments.
+// Returns the offset of the pixel data. Values that are 0 or out of range (a maximum value above 65535) are rejected.
+size_t read_pnm_header(const uint8_t* data, const size_t size, charls::frame_info& frame)
+{
+    size_t offset{};
+
+    const auto skip_whitespace_and_comments = [&] {
+        while (offset < size)
+        {
+            if (data[offset] == '#')
+            {
+                while (offset < size && data[offset] != '\n')
+                {
+                    ++offset;
+                }
+            }
+            else if (isspace(data[offset]))
+            {
+                ++offset;
+            }
+            else
+            {
+                break;
+            }
+        }
+    };
+
+    const auto read_value = [&](const uint32_t maximum) {
+        skip_whitespace_and_comments();
+        uint32_t value{};
+        const size_t start{offset};
+        while (offset < size && isdigit(data[offset]))
+        {
+            const uint32_t digit{static_cast<uint32_t>(data[offset] - '0')};
+            if (value > (maximum - digit) / 10)
+                throw std::runtime_error("PNM header value out of range");
+
+            value = value * 10 + digit;
+            ++offset;
+        }
+        if (offset == start || value == 0)
+            throw std::runtime_error("Invalid PNM header");
+        return value;
+    };
+
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+        throw std::runtime_error("Not a binary PGM (P5) or PPM (P6) file");
+    offset = 2;
+
+    frame.component_count = data[1] == '6' ? 3 : 1;
+    frame.width = read_value(std::numeric_limits<uint32_t>::max());
+    frame.height = read_value(std::numeric_limits<uint32_t>::max());
+    const uint32_t max_value{read_value(65535)};
+
+    frame.bits_per_sample = 1;
+    while ((1U << frame.bits_per_sample) <= max_value)
+    {
+        ++frame.bits_per_sample;
+    }
+
+    // A single whitespace character separates the header from the pixel data.
+    if (offset == size || !isspace(data[offset]))
+        throw std::runtime_error("Invalid PNM header");
+    return offset + 1;
+}
+
+size_t pixel_data_size(const charls::frame_info& frame)
+{
+    const size_t bytes_per_sample{frame.bits_per_sample > 8 ? 2U : 1U};
+    return static_cast<size_t>(frame.width) * frame.height * frame.component_count * bytes_per_sample;
+}
+
+void swap_byte_order(uint8_t* pixel_data, const size_t size) noexcept
+{
+    for (size_t i{}; i < size; i += 2)
+    {
+        std::swap(pixel_data[i], pixel_data[i + 1]);
+    }
+}
+
+conversion_result encode_file(const conversion_job& job, const options& options)
+{
+    // Copy-on-write: 16 bit samples are converted to little endian in place, without modifying the input file.
+    memory_mapped_file input{job.input_path.c_str(), memory_mapped_file::access::copy_on_write};
+
+    charls::frame_info frame{};
+    const size_t header_size{read_pnm_header(input.data(), input.size(), frame)};
+
+    // Compare without multiplying: the size computed from the header values could overflow.
+    const size_t pixel_size{pixel_data_size({1, 1, frame.bits_per_sample, frame.component_count})};
+    if ((input.size() - header_size) / pixel_size / frame.width < frame.height)
+        throw std::runtime_error("PNM file is too small for its pixel data");
+    const size_t size{pixel_data_size(frame)};
+
+    uint8_t* pixel_data{input.data() + header_size};
+    if (frame.bits_per_sample > 8)
+    {
+        // PNM format is stored with most significant byte first (big endian).
+        swap_byte_order(pixel_data, size);
+    }
+
+    charls::jpegls_encoder encoder;
+    encoder.frame_info(frame)
+        .interleave_mode(frame.component_count == 1 ? charls::interleave_mode::none : options.interleave_mode)
+        .near_lossless(options.near_lossless);
+
+    const string output_path{job.output_path + ".jls"};
+    create_parent_directories(output_path);
+    memory_mapped_file output{output_path.c_str(), encoder.estimated_destination_size()};
+    encoder.destination(output.data(), output.size());
+
+    if (frame.component_count == 3 && options.interleave_mode == charls::interleave_mode::none)
+    {
+        // The encoder expects the color planes one after the other when the interleave mode is none.
+        vector<uint8_t> planar(size);
+        const size_t sample_size{frame.bits_per_sample > 8 ? 2U : 1U};
+        const size_t plane_size{size / 3};
+        for (size_t source{}, target{}; source < size; source += 3 * sample_size, target += sample_size)
+        {
+            for (size_t component{}; component < 3; ++component)
+            {
+                memcpy(&planar[component * plane_size + target], &pixel_data[source + component * sample_size], sample_size);
+            }
+        }
+
+        const size_t encoded_size{encoder.encode(planar)};
+        output.close(encoded_size);
+        return {output_path, input.size(), encoded_size, size};
+    }
+
+    const size_t encoded_size{encoder.encode(pixel_data, size)};
+    output.close(encoded_size);
+    return {output_path, input.size(), encoded_size, size};
+}
+
+conversion_result decode_file(const conversion_job& job, const options& /*options*/)
+{
+    const memory_mapped_file input{job.input_path.c_str()};
+    charls::jpegls_decoder decoder{input};
+    decoder.read_header();
+
+    const charls::frame_info frame{decoder.frame_info()};
+    if (frame.component_count != 1 && frame.component_count != 3)
+        throw std::runtime_error("Only images with 1 or 3 components can be stored in the PNM format");
+
+    std::ostringstream header;
+    header << 'P' << (frame.component_count == 3 ? 6 : 5) << '\n'
+           << frame.width << ' ' << frame.height << '\n'
+           << (1 << frame.bits_per_sample) - 1 << '\n';
+    const string header_text{header.str()};
+
+    const size_t size{pixel_data_size(frame)};
+    const string output_path{job.output_path + (frame.component_count == 3 ? ".ppm" : ".pgm")};
+    create_parent_directories(output_path);
+    memory_mapped_file output{output_path.c_str(), header_text.size() + size};
+    memcpy(output.data(), header_text.data(), header_text.size());
+    uint8_t* pixel_data{output.data() + header_text.size()};
+
+    if (frame.component_count == 3 && decoder.interleave_mode() == charls::interleave_mode::none)
+    {
+        // The decoder returns the color planes one after the other when the interleave mode is none.
+        const auto planar{decoder.decode<vector<uint8_t>>()};
+        const size_t sample_size{frame.bits_per_sample > 8 ? 2U : 1U};
+        const size_t plane_size{size / 3};
+        for (size_t source{}, target{}; source < plane_size; source += sample_size, target += 3 * sample_size)
+        {
+            for (size_t component{}; component < 3; ++component)
+            {
+                memcpy(&pixel_data[target + component * sample_size], &planar[component * plane_size + source], sample_size);
+            }
+        }
+    }
+    else
+    {
+        decoder.decode(pixel_data, size);
+    }
+
+    if (frame.bits_per_sample > 8)
+    {
+        // PNM format requires most significant byte first (big endian).
+        swap_byte_order(pixel_data, size);
+    }
+
+    const size_t output_size{output.size()};
+    output.close(output_size);
+    return {output_path, input.size(), output_size, size};
+}
+
+
+struct batch_statistics final
+{
+    size_t converted_count{};
+    size_t failed_count{};
+    size_t input_size{};
+    size_t output_size{};
+    size_t pixel_data_size{};
+};
+
+// Runs the jobs on a fixed number of worker threads. The workers take the next job from a shared index, this keeps
+// the threads busy when the file sizes differ, without a queue that needs to be filled in advance.
+batch_statistics run_jobs(const vector<conversion_job>& jobs, const options& options)
+{
+    std::atomic<size_t> next_job{};
+    std::mutex mutex;
+    batch_statistics statistics;
+
+    const auto worker = [&]() noexcept {
+        for (size_t index = next_job++; index < jobs.size(); index = next_job++)
+        {
+            const conversion_job& job{jobs[index]};
+            const auto start{std::chrono::steady_clock::now()};
+            try
+            {
+                const conversion_result result{options.mode == operation::encode ? encode_file(job, options) : decode_file(job, options)};
+                const std::chrono::duration<double, std::milli> duration{std::chrono::steady_clock::now() - start};
+
+                const std::lock_guard<std::mutex> lock{mutex};
+                ++statistics.converted_count;
+                statistics.input_size += result.input_size;
+                statistics.output_size += result.output_size;
+                statistics.pixel_data_size += result.pixel_data_size;
+                if (!options.quiet)
+                {
+                    std::cout << job.input_path << " -> " << result.output_path << ": " << result.input_size << " -> "
+                              << result.output_size << " bytes, " << std::fixed << std::setprecision(2)
+                              << static_cast<double>(result.pixel_data_size) / (options.mode == operation::encode ? result.output_size : result.input_size)
+                              << ":1, " << duration.count() << " ms\n";
+                }
+            }
+            catch (const std::exception& error)
+            {
+                const std::lock_guard<std::mutex> lock{mutex};
+                ++statistics.failed_count;
+                std::cerr << job.input_path << ": " << error.what() << "\n";
+            }
+        }
+    };
+
+    vector<std::thread> threads;
+    const size_t thread_count{std::min<size_t>(options.thread_count, jobs.size())};
+    for (size_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    return statistics;
+}
+
+void log_failure(const char* message) noexcept
+{
+    try
+    {
+        std::cerr << message << "\n";
+    }
+    catch (...)
+    {
+        // Catch and ignore all exceptions,to ensure a noexcept log function (but warn in debug builds)
+        assert(false);
+    }
+}
+
+} // namespace
+
+
+int main(const int argc, char** argv)
+{
+    try
+    {
+        std::ios::sync_with_stdio(false);
+        const options options{argc, argv};
+
+        const vector<conversion_job> jobs{create_jobs(options)};
+        if (jobs.empty())
+            throw std::runtime_error("No input files found");
+
+        const auto start{std::chrono::steady_clock::now()};
+        const batch_statistics statistics{run_jobs(jobs, options)};
+        const std::chrono::duration<double> duration{std::chrono::steady_clock::now() - start};
+
+        constexpr double megabyte{1024 * 1024};
+        std::cout << std::fixed << std::setprecision(2)
+                  << statistics.converted_count << " files converted, " << statistics.failed_count << " failed, "
+                  << statistics.input_size / megabyte << " MB -> " << statistics.output_size / megabyte << " MB in "
+                  << duration.count() << " s (" << std::min<size_t>(options.thread_count, jobs.size()) << " threads): "
+                  << statistics.converted_count / duration.count() << " files/s, "
+                  << statistics.pixel_data_size / megabyte / duration.count() << " MB/s pixel data\n";
+
+        return statistics.failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& error)
+    {
+        log_failure(error.what());
+    }
+    catch (...)
+    {
+        log_failure("Unknown error occurred");
+        assert(false);
+    }
+
+    return EXIT_FAILURE;
+}
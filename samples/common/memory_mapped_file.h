@@ -0,0 +1,283 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Maps a file into the address space of the process. The encoder and decoder can then read from the page cache
+/// and write into it directly, without copying the data through a stream or an intermediate buffer.
+/// The mapping is created with a sequential access hint, as the codec reads and writes the data from start to end.
+/// </summary>
+class memory_mapped_file final
+{
+public:
+    using value_type = uint8_t;
+
+    enum class access
+    {
+        read_only,
+        copy_on_write // Pages can be modified in memory, the changes are never written back to the file.
+    };
+
+    /// <summary>
+    /// Maps an existing file.
+    /// </summary>
+    explicit memory_mapped_file(const char* filename, const access mode = access::read_only)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+            throw_last_error("CreateFile");
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_, &file_size))
+            throw_last_error("GetFileSizeEx");
+        size_ = static_cast<size_t>(file_size.QuadPart);
+
+        map(mode == access::read_only ? PAGE_READONLY : PAGE_WRITECOPY,
+            mode == access::read_only ? FILE_MAP_READ : FILE_MAP_COPY);
+#else
+        file_ = open(filename, O_RDONLY);
+        if (file_ == -1)
+            throw_last_error("open");
+
+        struct stat status;
+        if (fstat(file_, &status) == -1)
+            throw_last_error("fstat");
+        size_ = static_cast<size_t>(status.st_size);
+
+        map(mode == access::read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_PRIVATE);
+#endif
+    }
+
+    /// <summary>
+    /// Creates (or overwrites) a file of the passed size and maps it for writing.
+    /// Call close to keep the file and set its final size. The file is removed when it is destroyed without a call
+    /// to close, this ensures no incomplete file is left behind when an error occurs.
+    /// </summary>
+    memory_mapped_file(const char* filename, const size_t size) :
+        size_{size}
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+            throw_last_error("CreateFile");
+        created_filename_ = filename;
+
+        map(PAGE_READWRITE, FILE_MAP_WRITE);
+#else
+        file_ = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (file_ == -1)
+            throw_last_error("open");
+        created_filename_ = filename;
+
+        reserve(size);
+        map(PROT_READ | PROT_WRITE, MAP_SHARED);
+#endif
+    }
+
+    ~memory_mapped_file()
+    {
+        release();
+        remove_created_file();
+    }
+
+    memory_mapped_file(const memory_mapped_file&) = delete;
+    memory_mapped_file(memory_mapped_file&&) = delete;
+    memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+    memory_mapped_file& operator=(memory_mapped_file&&) = delete;
+
+    uint8_t* data() noexcept
+    {
+        return data_;
+    }
+
+    const uint8_t* data() const noexcept
+    {
+        return data_;
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    /// <summary>
+    /// Unmaps a file that was created for writing and truncates it to the number of bytes that have been written.
+    /// </summary>
+    void close(const size_t file_size)
+    {
+        unmap();
+
+#ifdef _WIN32
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(file_size);
+        if (!SetFilePointerEx(file_, position, nullptr, FILE_BEGIN) || !SetEndOfFile(file_))
+            throw_last_error("SetEndOfFile");
+#else
+        if (ftruncate(file_, static_cast<off_t>(file_size)) == -1)
+            throw_last_error("ftruncate");
+#endif
+
+        release();
+        created_filename_.clear();
+    }
+
+private:
+    void remove_created_file() noexcept
+    {
+        if (!created_filename_.empty())
+        {
+            static_cast<void>(std::remove(created_filename_.c_str()));
+            created_filename_.clear();
+        }
+    }
+
+#ifdef _WIN32
+    void map(const DWORD protection, const DWORD desired_access)
+    {
+        if (size_ == 0)
+            return; // Empty files cannot be mapped.
+
+        const auto size{static_cast<ULONGLONG>(size_)};
+        mapping_ = CreateFileMappingA(file_, nullptr, protection, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+        if (!mapping_)
+            throw_last_error("CreateFileMapping");
+
+        data_ = static_cast<uint8_t*>(MapViewOfFile(mapping_, desired_access, 0, 0, size_));
+        if (!data_)
+            throw_last_error("MapViewOfFile");
+    }
+
+    void unmap() noexcept
+    {
+        if (data_)
+        {
+            UnmapViewOfFile(data_);
+            data_ = nullptr;
+        }
+
+        if (mapping_)
+        {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+    }
+
+    void release() noexcept
+    {
+        unmap();
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    [[noreturn]] void throw_last_error(const char* function_name)
+    {
+        const std::error_code error{static_cast<int>(GetLastError()), std::system_category()};
+        release();
+        remove_created_file();
+        throw std::system_error(error, function_name);
+    }
+
+    HANDLE file_{INVALID_HANDLE_VALUE};
+    HANDLE mapping_{};
+#else
+    void map(const int protection, const int flags)
+    {
+        if (size_ == 0)
+            return; // Empty files cannot be mapped.
+
+        void* address{mmap(nullptr, size_, protection, flags, file_, 0)};
+        if (address == MAP_FAILED)
+            throw_last_error("mmap");
+        data_ = static_cast<uint8_t*>(address);
+
+        // The hint is only an optimization: the read-ahead of the kernel becomes more aggressive.
+        static_cast<void>(madvise(address, size_, MADV_SEQUENTIAL));
+    }
+
+    // Allocates the disk space of a new file. A write through the mapping into a sparse file raises SIGBUS when the disk
+    // is full, an allocation failure is reported as an exception instead.
+    void reserve(const size_t size)
+    {
+        if (size == 0)
+            return;
+
+#ifdef __APPLE__
+        const int result{EOPNOTSUPP}; // macOS has no posix_fallocate.
+#else
+        const int result{posix_fallocate(file_, 0, static_cast<off_t>(size))};
+#endif
+        if (result == 0)
+            return;
+
+        if (result != EOPNOTSUPP && result != EINVAL)
+        {
+            errno = result;
+            throw_last_error("posix_fallocate");
+        }
+
+        // The file system cannot allocate the space in advance, only set the size.
+        if (ftruncate(file_, static_cast<off_t>(size)) == -1)
+            throw_last_error("ftruncate");
+    }
+
+    void unmap() noexcept
+    {
+        if (data_)
+        {
+            munmap(data_, size_);
+            data_ = nullptr;
+        }
+    }
+
+    void release() noexcept
+    {
+        unmap();
+        if (file_ != -1)
+        {
+            ::close(file_);
+            file_ = -1;
+        }
+    }
+
+    [[noreturn]] void throw_last_error(const char* function_name)
+    {
+        const std::error_code error{errno, std::generic_category()};
+        release();
+        remove_created_file();
+        throw std::system_error(error, function_name);
+    }
+
+    int file_{-1};
+#endif
+
+    uint8_t* data_{};
+    size_t size_{};
+    std::string created_filename_; // Only set for a file that is created for writing and not yet closed.
+};
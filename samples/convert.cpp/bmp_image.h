@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include "../common/memory_mapped_file.h"
+
 #include <cstddef>
-#include <fstream>
-#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
 
 class bmp_image final
 {
@@ -43,80 +46,80 @@ class bmp_image final
         uint32_t number_important_colors; // the number of important colors used, or 0 when every color is important generally ignored.
     };
 
-    explicit bmp_image(const char* filename)
+    explicit bmp_image(const char* filename) :
+        file_{filename, memory_mapped_file::access::copy_on_write}
     {
-        std::ifstream input;
-        input.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
-        input.open(filename, std::ios_base::in | std::ios_base::binary);
-
-        header = read_bmp_header(input);
+        // The file is mapped copy-on-write: the pixels are converted in place by the caller, without modifying the file.
+        size_t offset{};
+        header = read_bmp_header(offset);
         if (header.magic != 0x4D42)
-            throw std::istream::failure("Missing BMP identifier");
+            throw std::runtime_error("Missing BMP identifier");
 
-        dib_header = read_dib_header(input);
+        dib_header = read_dib_header(offset);
         if (dib_header.header_size < 40 || dib_header.compress_type != 0 || dib_header.depth != 24)
-            throw std::istream::failure("Can only read uncompressed 24 bits BMP files");
+            throw std::runtime_error("Can only read uncompressed 24 bits BMP files");
 
         if (dib_header.width == 0 || dib_header.height == 0)
-            throw std::istream::failure("Can only process an image that is 1 x 1 or bigger");
+            throw std::runtime_error("Can only process an image that is 1 x 1 or bigger");
 
         // The BMP format requires that the size of each row is rounded up to a multiple of 4 bytes by padding.
         constexpr int bytes_per_pixel = 3;
         stride = ((dib_header.width * bytes_per_pixel) + 3) / 4 * 4;
 
-        pixel_data = read_pixel_data(input, header.offset, dib_header.height, stride);
+        pixel_data_size = static_cast<size_t>(std::abs(dib_header.height)) * stride;
+        if (header.offset > file_.size() || file_.size() - header.offset < pixel_data_size)
+            throw std::runtime_error("BMP file is too small for its pixel data");
+
+        pixel_data = file_.data() + header.offset;
     }
 
     bmp_header header;
     bmp_dib_header dib_header;
     uint32_t stride{};
-    std::vector<uint8_t> pixel_data;
+    uint8_t* pixel_data{};
+    size_t pixel_data_size{};
 
 private:
-    static bmp_header read_bmp_header(std::istream& input)
+    bmp_header read_bmp_header(size_t& offset) const
     {
         bmp_header result{};
 
-        read(input, result.magic);
-        read(input, result.file_size);
-        read(input, result.reserved);
-        read(input, result.offset);
+        read(offset, result.magic);
+        read(offset, result.file_size);
+        read(offset, result.reserved);
+        read(offset, result.offset);
 
         return result;
     }
 
-    static bmp_dib_header read_dib_header(std::istream& input)
+    bmp_dib_header read_dib_header(size_t& offset) const
     {
         bmp_dib_header result{};
 
-        read(input, result.header_size);
-        read(input, result.width);
-        read(input, result.height);
-        read(input, result.number_planes);
-        read(input, result.depth);
-        read(input, result.compress_type);
-        read(input, result.bmp_byte_size);
-        read(input, result.horizontal_resolution);
-        read(input, result.vertical_resolution);
-        read(input, result.number_colors);
-        read(input, result.number_important_colors);
+        read(offset, result.header_size);
+        read(offset, result.width);
+        read(offset, result.height);
+        read(offset, result.number_planes);
+        read(offset, result.depth);
+        read(offset, result.compress_type);
+        read(offset, result.bmp_byte_size);
+        read(offset, result.horizontal_resolution);
+        read(offset, result.vertical_resolution);
+        read(offset, result.number_colors);
+        read(offset, result.number_important_colors);
 
         return result;
     }
 
-    static std::vector<uint8_t> read_pixel_data(std::istream& input, const uint32_t offset, const int32_t height, const uint32_t stride)
+    template<typename T>
+    void read(size_t& offset, T& value) const
     {
-        input.seekg(offset);
+        if (file_.size() - offset < sizeof value)
+            throw std::runtime_error("BMP file is too small for its header");
 
-        std::vector<uint8_t> pixel_data(static_cast<size_t>(height) * stride);
-        input.read(reinterpret_cast<char*>(pixel_data.data()), static_cast<std::streamsize>(pixel_data.size()));
-
-        return pixel_data;
+        memcpy(&value, file_.data() + offset, sizeof value);
+        offset += sizeof value;
     }
 
-    template<typename T>
-    static void read(std::istream& input, T& value)
-    {
-        input.read(reinterpret_cast<char*>(&value), sizeof value);
-    }
+    memory_mapped_file file_;
 };
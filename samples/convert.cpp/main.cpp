@@ -4,6 +4,7 @@
 #include "pch.h"
 
 #include "bmp_image.h"
+#include "../common/memory_mapped_file.h"
 
 #include <charls/charls.h>
 
@@ -16,7 +17,7 @@ namespace {
 
 constexpr size_t bytes_per_rgb_pixel = 3;
 
-void convert_bgr_to_rgb(std::vector<uint8_t>& triplet_buffer, const size_t width, const size_t height, const size_t stride) noexcept
+void convert_bgr_to_rgb(uint8_t* triplet_buffer, const size_t width, const size_t height, const size_t stride) noexcept
 {
     for (size_t line = 0; line < height; ++line)
     {
@@ -29,7 +30,7 @@ void convert_bgr_to_rgb(std::vector<uint8_t>& triplet_buffer, const size_t width
     }
 }
 
-std::vector<uint8_t> triplet_to_planar(const std::vector<uint8_t>& buffer, const size_t width, const size_t height, const size_t stride)
+std::vector<uint8_t> triplet_to_planar(const uint8_t* buffer, const size_t width, const size_t height, const size_t stride)
 {
     std::vector<uint8_t> result(bytes_per_rgb_pixel * width * height);
     const size_t byte_count_plane = width * height;
@@ -65,7 +66,7 @@ void convert_bottom_up_to_top_down(uint8_t* triplet_buffer, const size_t width,
     }
 }
 
-std::vector<uint8_t> encode_bmp_image_to_jpegls(const bmp_image& image, const charls::interleave_mode interleave_mode, const int near_lossless)
+void encode_bmp_image_to_jpegls(const bmp_image& image, const charls::interleave_mode interleave_mode, const int near_lossless, const char* output_filename)
 {
     assert(image.dib_header.depth == 24);        // This function only supports 24-bit BMP pixel data.
     assert(image.dib_header.compress_type == 0); // Data needs to be stored by pixel as RGB.
@@ -75,8 +76,9 @@ std::vector<uint8_t> encode_bmp_image_to_jpegls(const bmp_image& image, const ch
         .interleave_mode(interleave_mode)
         .near_lossless(near_lossless);
 
-    std::vector<uint8_t> buffer(encoder.estimated_destination_size());
-    encoder.destination(buffer);
+    // The encoded bytes are written directly into the mapped output file, which is truncated to the actual size afterwards.
+    memory_mapped_file output{output_filename, encoder.estimated_destination_size()};
+    encoder.destination(output.data(), output.size());
 
     // The resolution in BMP files is often 0 to indicate that no resolution has been defined.
     // The SPIFF header specification requires however that VRES and HRES are never 0.
@@ -103,23 +105,10 @@ std::vector<uint8_t> encode_bmp_image_to_jpegls(const bmp_image& image, const ch
     }
     else
     {
-        encoded_size = encoder.encode(image.pixel_data, image.stride);
+        encoded_size = encoder.encode(image.pixel_data, image.pixel_data_size, image.stride);
     }
-    buffer.resize(encoded_size);
 
-    return buffer;
-}
-
-void save_buffer_to_file(const void* buffer, const size_t buffer_size, const char* filename)
-{
-    assert(filename);
-    assert(buffer);
-    assert(buffer_size);
-
-    std::ofstream output(filename, std::ios::binary);
-    output.exceptions(std::ios::failbit | std::ios::badbit);
-
-    output.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(buffer_size));
+    output.close(encoded_size);
 }
 
 void log_failure(const char* message) noexcept
@@ -202,7 +191,7 @@ int main(const int argc, char** argv)
         // Pixels in the BMP file format are stored bottom up (when the height parameter is positive), JPEG-LS requires top down.
         if (bmp_image.dib_header.height > 0)
         {
-            convert_bottom_up_to_top_down(bmp_image.pixel_data.data(), bmp_image.dib_header.width, static_cast<size_t>(bmp_image.dib_header.height), bmp_image.stride);
+            convert_bottom_up_to_top_down(bmp_image.pixel_data, bmp_image.dib_header.width, static_cast<size_t>(bmp_image.dib_header.height), bmp_image.stride);
         }
         else
         {
@@ -213,8 +202,7 @@ int main(const int argc, char** argv)
         // Note: without the optional SPIFF header no color information is stored in the JPEG-LS file and the common assumption is RGB.
         convert_bgr_to_rgb(bmp_image.pixel_data, bmp_image.dib_header.width, static_cast<size_t>(bmp_image.dib_header.height), bmp_image.stride);
 
-        auto encoded_buffer = encode_bmp_image_to_jpegls(bmp_image, options.interleave_mode, options.near_lossless);
-        save_buffer_to_file(encoded_buffer.data(), encoded_buffer.size(), options.output_filename);
+        encode_bmp_image_to_jpegls(bmp_image, options.interleave_mode, options.near_lossless, options.output_filename);
 
         return EXIT_SUCCESS;
     }
@@ -0,0 +1,116 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "allocator.h"
+
+#include <charls/charls.h>
+
+namespace {
+
+charls_allocate_function current_allocate_function{};
+charls_free_function current_free_function{};
+void* current_user_context{};
+
+thread_local charls::workspace* current_workspace{};
+
+} // namespace
+
+namespace charls {
+
+void* allocate(const std::size_t size)
+{
+    if (current_workspace)
+        return current_workspace->allocate(size);
+
+    if (!current_allocate_function)
+        return ::operator new(size);
+
+    void* pointer{current_allocate_function(current_user_context, size)};
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void deallocate(void* pointer) noexcept
+{
+    if (!pointer)
+        return;
+
+    if (current_workspace && current_workspace->contains(pointer))
+    {
+        current_workspace->deallocate(pointer);
+        return;
+    }
+
+    if (current_free_function)
+    {
+        current_free_function(current_user_context, pointer);
+    }
+    else
+    {
+        ::operator delete(pointer);
+    }
+}
+
+
+void* workspace::allocate(const std::size_t size)
+{
+    if (size > end_ - top_ || block_size(size) > end_ - top_)
+        throw std::bad_alloc();
+
+    auto* header{new (reinterpret_cast<void*>(top_)) block_header{last_, false}};
+    last_ = header;
+    top_ += block_size(size);
+    return reinterpret_cast<uint8_t*>(header) + header_size;
+}
+
+void workspace::deallocate(void* pointer) noexcept
+{
+    auto* header{reinterpret_cast<block_header*>(static_cast<uint8_t*>(pointer) - header_size)};
+    header->freed = true;
+
+    // Release the freed blocks at the top of the stack.
+    while (last_ && last_->freed)
+    {
+        top_ = reinterpret_cast<std::uintptr_t>(last_);
+        last_ = last_->previous;
+    }
+}
+
+
+workspace_scope::workspace_scope(workspace* active_workspace) noexcept :
+    previous_{current_workspace}
+{
+    if (active_workspace)
+    {
+        current_workspace = active_workspace;
+    }
+}
+
+workspace_scope::~workspace_scope()
+{
+    current_workspace = previous_;
+}
+
+} // namespace charls
+
+using namespace charls;
+
+extern "C" {
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_set_allocator(IN_OPT_ const charls_allocate_function allocate_function,
+                     IN_OPT_ const charls_free_function free_function,
+                     IN_OPT_ void* user_context) noexcept
+{
+    // Memory can only be freed by the counterpart of the function that allocated it: both or none must be set.
+    if ((allocate_function == nullptr) != (free_function == nullptr))
+        return jpegls_errc::invalid_argument;
+
+    current_allocate_function = allocate_function;
+    current_free_function = free_function;
+    current_user_context = user_context;
+    return jpegls_errc::success;
+}
+}
@@ -0,0 +1,192 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace charls {
+
+/// <summary>
+/// Allocates memory from the workspace that is active on the calling thread, or else with the function set by
+/// charls_set_allocator, or with operator new when no function is set.
+/// Throws std::bad_alloc when the memory cannot be allocated.
+/// </summary>
+void* allocate(std::size_t size);
+
+/// <summary>
+/// Frees memory that was allocated with allocate.
+/// </summary>
+void deallocate(void* pointer) noexcept;
+
+
+/// <summary>
+/// Standard library compatible allocator, used by the internal containers to route their memory through allocate and deallocate.
+/// </summary>
+template<typename T>
+class allocator
+{
+public:
+    using value_type = T;
+
+    allocator() = default;
+
+    template<typename U>
+    allocator(const allocator<U>& /*other*/) noexcept // NOLINT(google-explicit-constructor)
+    {
+    }
+
+    T* allocate(const std::size_t count)
+    {
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_array_new_length();
+
+        return static_cast<T*>(charls::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t /*count*/) noexcept
+    {
+        charls::deallocate(pointer);
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const allocator<T>& /*lhs*/, const allocator<U>& /*rhs*/) noexcept
+{
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const allocator<T>& /*lhs*/, const allocator<U>& /*rhs*/) noexcept
+{
+    return false;
+}
+
+template<typename T>
+using allocated_vector = std::vector<T, allocator<T>>;
+
+
+/// <summary>
+/// Base class for the internal objects that are created on the heap, routes their new and delete through allocate and deallocate.
+/// </summary>
+struct allocated_object
+{
+    static void* operator new(const std::size_t size)
+    {
+        return allocate(size);
+    }
+
+    static void* operator new(const std::size_t size, const std::nothrow_t& /*tag*/) noexcept
+    {
+        try
+        {
+            return allocate(size);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+
+    static void operator delete(void* pointer) noexcept
+    {
+        deallocate(pointer);
+    }
+
+    static void operator delete(void* pointer, const std::nothrow_t& /*tag*/) noexcept
+    {
+        deallocate(pointer);
+    }
+};
+
+
+/// <summary>
+/// Stack allocator on a caller-provided memory block. Freed blocks are released when all blocks allocated after them
+/// have been freed as well, which matches the nested lifetimes of the objects and buffers of a scan.
+/// </summary>
+class workspace final
+{
+public:
+    workspace() = default;
+
+    workspace(void* data, const std::size_t size) noexcept :
+        begin_{align_up(reinterpret_cast<std::uintptr_t>(data))},
+        end_{reinterpret_cast<std::uintptr_t>(data) + size},
+        top_{begin_}
+    {
+        if (begin_ > end_)
+        {
+            begin_ = end_;
+            top_ = end_;
+        }
+    }
+
+    /// <summary>
+    /// Returns the number of bytes in the workspace that an allocation of the passed size uses.
+    /// </summary>
+    static constexpr std::size_t block_size(const std::size_t size) noexcept
+    {
+        return header_size + align_up(size);
+    }
+
+    void* allocate(std::size_t size);
+    void deallocate(void* pointer) noexcept;
+
+    bool contains(const void* pointer) const noexcept
+    {
+        const auto address{reinterpret_cast<std::uintptr_t>(pointer)};
+        return begin_ <= address && address < end_;
+    }
+
+    bool in_use() const noexcept
+    {
+        return last_ != nullptr;
+    }
+
+    static constexpr std::size_t alignment{alignof(std::max_align_t)};
+
+private:
+    struct block_header
+    {
+        block_header* previous;
+        bool freed;
+    };
+
+    static constexpr std::size_t align_up(const std::size_t size) noexcept
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    static constexpr std::size_t header_size{(sizeof(block_header) + alignment - 1) & ~(alignment - 1)};
+
+    std::uintptr_t begin_{};
+    std::uintptr_t end_{};
+    std::uintptr_t top_{};
+    block_header* last_{};
+};
+
+
+/// <summary>
+/// Routes the allocations of the calling thread to a workspace while the scope exists.
+/// A null pointer leaves the current routing unchanged.
+/// </summary>
+class workspace_scope final
+{
+public:
+    explicit workspace_scope(workspace* active_workspace) noexcept;
+    ~workspace_scope();
+
+    workspace_scope(const workspace_scope&) = delete;
+    workspace_scope(workspace_scope&&) = delete;
+    workspace_scope& operator=(const workspace_scope&) = delete;
+    workspace_scope& operator=(workspace_scope&&) = delete;
+
+private:
+    workspace* previous_;
+};
+
+} // namespace charls
@@ -3,6 +3,10 @@
 
 #include <charls/charls.h>
 
+#include "allocator.h"
+#include "constants.h"
+#include "decoder_strategy.h"
+#include "jls_codec_factory.h"
 #include "jpeg_stream_reader.h"
 #include "util.h"
 
@@ -14,8 +18,64 @@ using std::unique_ptr;
 using namespace charls;
 using impl::throw_jpegls_error;
 
-struct charls_jpegls_decoder final
+namespace {
+
+// The workspace holds the blocks that are allocated while decoding: the codec with its quantization lookup table,
+// the process line with its line buffers, the scan line buffers, the run indexes and the scan statistics.
+size_t workspace_size(const frame_info& frame, const charls::interleave_mode interleave_mode)
+{
+    if (frame.width < 1 || frame.width > maximum_width)
+        throw_jpegls_error(jpegls_errc::invalid_argument_width);
+
+    if (frame.height < 1 || frame.height > maximum_height)
+        throw_jpegls_error(jpegls_errc::invalid_argument_height);
+
+    if (frame.bits_per_sample < minimum_bits_per_sample || frame.bits_per_sample > maximum_bits_per_sample)
+        throw_jpegls_error(jpegls_errc::invalid_argument_bits_per_sample);
+
+    if (frame.component_count < 1 || frame.component_count > maximum_component_count)
+        throw_jpegls_error(jpegls_errc::invalid_argument_component_count);
+
+    if (interleave_mode < charls::interleave_mode::none || interleave_mode > charls::interleave_mode::sample)
+        throw_jpegls_error(jpegls_errc::invalid_argument_interleave_mode);
+
+    const size_t sample_size{bit_to_byte_count(frame.bits_per_sample)};
+    const auto component_count{static_cast<size_t>(frame.component_count)};
+    const size_t line_component_count{interleave_mode == charls::interleave_mode::none ? 1 : component_count};
+    const size_t pixel_stride{static_cast<size_t>(frame.width) + 4};
+
+    size_t size{workspace::alignment - 1};
+    size += workspace::block_size(jls_codec_factory<decoder_strategy>::maximum_codec_size());
+    size += workspace::block_size(static_cast<size_t>(2) << frame.bits_per_sample);
+    size += workspace::block_size(jls_codec_factory<decoder_strategy>::maximum_process_line_size());
+    if (interleave_mode != charls::interleave_mode::none)
+    {
+        size += 2 * workspace::block_size(component_count * frame.width * sample_size);
+    }
+    size += workspace::block_size(2 * line_component_count * pixel_stride * sample_size);
+    size += workspace::block_size(line_component_count * sizeof(int32_t));
+    size += workspace::block_size(component_count * sizeof(charls::scan_statistics));
+    return size;
+}
+
+} // namespace
+
+struct charls_jpegls_decoder final : allocated_object
 {
+    charls_jpegls_decoder() = default;
+
+    ~charls_jpegls_decoder()
+    {
+        // The scan statistics of the reader can be stored in the workspace.
+        const workspace_scope scope{active_workspace()};
+        reader_.reset();
+    }
+
+    charls_jpegls_decoder(const charls_jpegls_decoder&) = delete;
+    charls_jpegls_decoder(charls_jpegls_decoder&&) = delete;
+    charls_jpegls_decoder& operator=(const charls_jpegls_decoder&) = delete;
+    charls_jpegls_decoder& operator=(charls_jpegls_decoder&&) = delete;
+
     void source(IN_READS_BYTES_(source_size_bytes) const void* source_buffer,
                 const size_t source_size_bytes) CHARLS_ATTRIBUTE((nonnull))
     {
@@ -30,6 +90,15 @@ struct charls_jpegls_decoder final
         state_ = state::source_set;
     }
 
+    void source_segments(IN_READS_(segment_count) const buffer_segment* segments, const size_t segment_count) CHARLS_ATTRIBUTE((nonnull))
+    {
+        if (state_ != state::initial)
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        reader_ = std::make_unique<jpeg_stream_reader>(segments, segment_count);
+        state_ = state::source_set;
+    }
+
     bool read_header(OUT_ spiff_header* spiff_header)
     {
         if (state_ != state::source_set)
@@ -129,10 +198,57 @@ struct charls_jpegls_decoder final
         if (state_ != state::header_read)
             throw_jpegls_error(jpegls_errc::invalid_operation);
 
+        if (workspace_size_ != 0 && workspace_size_ < workspace_size(reader_->frame_info(), reader_->parameters().interleave_mode))
+            throw_jpegls_error(jpegls_errc::not_enough_memory);
+
         const byte_stream_info destination = from_byte_array(destination_buffer, destination_size_bytes);
+        reader_->collect_scan_statistics(collect_scan_statistics_);
+
+        const workspace_scope scope{active_workspace()};
         reader_->read(destination, stride);
     }
 
+    void workspace(IN_OPT_ void* workspace_buffer, const size_t workspace_size_bytes)
+    {
+        if (workspace_.in_use())
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        if (!workspace_buffer && workspace_size_bytes != 0)
+            throw_jpegls_error(jpegls_errc::invalid_argument);
+
+        workspace_ = charls::workspace{workspace_buffer, workspace_size_bytes};
+        workspace_size_ = workspace_size_bytes;
+    }
+
+    void collect_scan_statistics(const bool collect) noexcept
+    {
+        collect_scan_statistics_ = collect;
+    }
+
+    const charls::scan_statistics& scan_statistics(const int32_t scan_index) const
+    {
+        if (!reader_ || reader_->scan_statistics().empty())
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        const auto& scan_statistics = reader_->scan_statistics();
+        if (scan_index < 0 || static_cast<size_t>(scan_index) >= scan_statistics.size())
+            throw_jpegls_error(jpegls_errc::invalid_argument);
+
+        return scan_statistics[static_cast<size_t>(scan_index)];
+    }
+
+    const charls::timing_statistics& timing_statistics() const
+    {
+#ifndef CHARLS_TIMING
+        throw_jpegls_error(jpegls_errc::invalid_operation);
+#else
+        if (!reader_)
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        return reader_->timing_statistics();
+#endif
+    }
+
     void output_bgr(const bool value) const noexcept
     {
         reader_->output_bgr(value);
@@ -154,10 +270,18 @@ struct charls_jpegls_decoder final
         completed
     };
 
+    charls::workspace* active_workspace() const noexcept
+    {
+        return workspace_size_ == 0 ? nullptr : &workspace_;
+    }
+
     state state_{};
     unique_ptr<jpeg_stream_reader> reader_;
+    mutable charls::workspace workspace_;
+    size_t workspace_size_{};
     const void* source_buffer_{};
     size_t size_{};
+    bool collect_scan_statistics_{};
 };
 
 
@@ -191,6 +315,20 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_source_segments(IN_ charls_jpegls_decoder* decoder,
+                                          IN_READS_(segment_count) const charls_buffer_segment* segments,
+                                          const size_t segment_count) noexcept
+try
+{
+    check_pointer(decoder)->source_segments(check_pointer(segments), segment_count);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_decoder_read_spiff_header(IN_ charls_jpegls_decoder* const decoder,
                                         OUT_ charls_spiff_header* spiff_header,
@@ -244,6 +382,45 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_collect_scan_statistics(IN_ charls_jpegls_decoder* decoder, const bool collect) noexcept
+try
+{
+    check_pointer(decoder)->collect_scan_statistics(collect);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_scan_statistics(IN_ const charls_jpegls_decoder* decoder,
+                                          const int32_t scan_index,
+                                          OUT_ charls_scan_statistics* scan_statistics) noexcept
+try
+{
+    *check_pointer(scan_statistics) = check_pointer(decoder)->scan_statistics(scan_index);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_timing_statistics(IN_ const charls_jpegls_decoder* decoder,
+                                            OUT_ charls_timing_statistics* timing_statistics) noexcept
+try
+{
+    *check_pointer(timing_statistics) = check_pointer(decoder)->timing_statistics();
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 charls_jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_decoder_get_interleave_mode(IN_ const charls_jpegls_decoder* decoder,
                                           OUT_ charls_interleave_mode* interleave_mode) noexcept
@@ -285,6 +462,34 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_get_workspace_size(IN_ const charls_frame_info* frame_info,
+                                         const charls_interleave_mode interleave_mode,
+                                         OUT_ size_t* workspace_size_bytes) noexcept
+try
+{
+    *check_pointer(workspace_size_bytes) = workspace_size(*check_pointer(frame_info), interleave_mode);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_decoder_set_workspace(IN_ charls_jpegls_decoder* decoder,
+                                    OUT_WRITES_BYTES_(workspace_size_bytes) void* workspace_buffer,
+                                    const size_t workspace_size_bytes) noexcept
+try
+{
+    check_pointer(decoder)->workspace(workspace_buffer, workspace_size_bytes);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_decoder_decode_to_buffer(IN_ const charls_jpegls_decoder* decoder,
                                        OUT_WRITES_BYTES_(destination_size_bytes) void* destination_buffer,
@@ -300,6 +505,26 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_probe(IN_READS_BYTES_(source_size_bytes) const void* source_buffer,
+                    const size_t source_size_bytes,
+                    OUT_ charls_probe_info* probe_info) noexcept
+try
+{
+    // The reader lives on the stack and doesn't allocate memory while parsing the header segments.
+    jpeg_stream_reader reader{from_byte_array_const(check_pointer(source_buffer), source_size_bytes)};
+    reader.read_header();
+    reader.read_start_of_scan();
+
+    const coding_parameters& parameters{reader.parameters()};
+    *check_pointer(probe_info) = {reader.frame_info(), parameters.near_lossless, parameters.interleave_mode, parameters.transformation};
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 jpegls_errc CHARLS_API_CALLING_CONVENTION
 JpegLsReadHeader(
     IN_READS_BYTES_(source_length) const void* source,
@@ -7,8 +7,10 @@
 #include "jls_codec_factory.h"
 #include "jpeg_stream_writer.h"
 #include "jpegls_preset_coding_parameters.h"
+#include "timing.h"
 #include "util.h"
 
+#include <algorithm>
 #include <cassert>
 #include <new>
 
@@ -16,7 +18,18 @@ using namespace charls;
 using impl::throw_jpegls_error;
 using std::unique_ptr;
 
-struct charls_jpegls_encoder final
+namespace {
+
+// Height of the image strips that are used to evaluate the coding parameters and the distance between the strips.
+constexpr uint32_t trial_strip_height{16};
+constexpr uint32_t trial_strip_distance{256};
+
+// Short strips favor parameters that adapt quickly: a candidate is only selected when it is more than 1% smaller.
+constexpr size_t minimum_improvement_divisor{100};
+
+} // namespace
+
+struct charls_jpegls_encoder final : allocated_object
 {
     charls_jpegls_encoder() = default;
 
@@ -29,6 +42,15 @@ struct charls_jpegls_encoder final
         state_ = state::destination_set;
     }
 
+    void destination_handler(const destination_buffer_handler handler, void* user_context)
+    {
+        if (state_ != state::initial)
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        writer_.update_destination(handler, user_context);
+        state_ = state::destination_set;
+    }
+
     void frame_info(const charls_frame_info& frame_info)
     {
         if (frame_info.width < 1 || frame_info.width > maximum_width)
@@ -78,6 +100,41 @@ struct charls_jpegls_encoder final
         color_transformation_ = color_transformation;
     }
 
+    void collect_scan_statistics(const bool collect) noexcept
+    {
+        collect_scan_statistics_ = collect;
+    }
+
+    void auto_coding_parameters(const bool enable) noexcept
+    {
+        auto_coding_parameters_ = enable;
+    }
+
+    void pipelined_encoding(const bool enable) noexcept
+    {
+        pipelined_encoding_ = enable;
+    }
+
+    const charls::scan_statistics& scan_statistics(const int32_t scan_index) const
+    {
+        if (scan_statistics_.empty())
+            throw_jpegls_error(jpegls_errc::invalid_operation);
+
+        if (scan_index < 0 || static_cast<size_t>(scan_index) >= scan_statistics_.size())
+            throw_jpegls_error(jpegls_errc::invalid_argument);
+
+        return scan_statistics_[static_cast<size_t>(scan_index)];
+    }
+
+    const charls::timing_statistics& timing_statistics() const
+    {
+#ifndef CHARLS_TIMING
+        throw_jpegls_error(jpegls_errc::invalid_operation);
+#else
+        return timing_;
+#endif
+    }
+
     size_t estimated_destination_size() const
     {
         if (!is_frame_info_configured())
@@ -156,6 +213,13 @@ struct charls_jpegls_encoder final
             }
         }
 
+        if (auto_coding_parameters_)
+        {
+            select_coding_parameters(static_cast<const uint8_t*>(source), stride);
+        }
+
+        scan_statistics_.clear();
+        timing_ = {};
         if (state_ == state::spiff_header)
         {
             writer_.write_spiff_end_of_directory_entry();
@@ -230,9 +294,23 @@ struct charls_jpegls_encoder final
     {
         const charls::frame_info frame_info{frame_info_.width, frame_info_.height, frame_info_.bits_per_sample, component_count};
 
-        auto codec = jls_codec_factory<encoder_strategy>().create_codec(frame_info,
-                                                                        {near_lossless_, interleave_mode_, color_transformation_, false},
-                                                                        preset_coding_parameters_);
+        unique_ptr<encoder_strategy> codec;
+        {
+            const scoped_timer timer{&timing_, &charls::timing_statistics::create_codec_nanoseconds};
+            codec = jls_codec_factory<encoder_strategy>().create_codec(frame_info,
+                                                                       {near_lossless_, interleave_mode_, color_transformation_, false},
+                                                                       preset_coding_parameters_);
+        }
+        codec->collect_timing(&timing_);
+        codec->pipelined(pipelined_encoding_);
+        codec->destination_buffers(writer_.chain());
+
+        if (collect_scan_statistics_)
+        {
+            scan_statistics_.emplace_back();
+            codec->collect_statistics(&scan_statistics_.back());
+        }
+
         unique_ptr<process_line> process_line(codec->create_process_line(source, stride));
         byte_stream_info destination{writer_.output_stream()};
         const size_t bytes_written = codec->encode_scan(move(process_line), destination);
@@ -241,6 +319,144 @@ struct charls_jpegls_encoder final
         writer_.seek(bytes_written);
     }
 
+    // Trial encodes horizontal strips of the image with candidate color transformations and preset coding parameters and
+    // selects the candidates that result in the smallest size. The candidates are evaluated one parameter at a time, which
+    // limits the extra cost to about 8 trial encodes of 1/16 of the image.
+    // Note: the interleave mode is not a candidate, as it defines the layout of the source and of the decoded image.
+    void select_coding_parameters(const uint8_t* source, const uint32_t stride)
+    {
+        allocated_vector<uint8_t> buffer(trial_buffer_size());
+        charls::color_transformation best_transformation{color_transformation_};
+        const jpegls_pc_parameters initial_preset{resolve_preset_coding_parameters()};
+        jpegls_pc_parameters best_preset{initial_preset};
+        size_t best_size{trial_encode(source, stride, best_transformation, best_preset, buffer)};
+
+        const auto try_candidate = [&](const charls::color_transformation transformation, const jpegls_pc_parameters& preset) {
+            const size_t size{trial_encode(source, stride, transformation, preset, buffer)};
+            if (size + size / minimum_improvement_divisor < best_size)
+            {
+                best_size = size;
+                best_transformation = transformation;
+                best_preset = preset;
+            }
+        };
+
+        // The HP color transformations are only defined for lossless coding of 3 component images.
+        if (frame_info_.component_count == 3 && interleave_mode_ != charls::interleave_mode::none && near_lossless_ == 0 &&
+            (frame_info_.bits_per_sample == 8 || frame_info_.bits_per_sample == 16))
+        {
+            for (const auto transformation : {charls::color_transformation::none, charls::color_transformation::hp1,
+                                              charls::color_transformation::hp2, charls::color_transformation::hp3})
+            {
+                if (transformation != color_transformation_)
+                {
+                    try_candidate(transformation, best_preset);
+                }
+            }
+        }
+
+        const jpegls_pc_parameters thresholds_preset{best_preset};
+        try_candidate(best_transformation, scale_thresholds(thresholds_preset, 1, 2));
+        try_candidate(best_transformation, scale_thresholds(thresholds_preset, 2, 1));
+
+        const jpegls_pc_parameters reset_preset{best_preset};
+        const int32_t maximum_reset_value{std::max(255, reset_preset.maximum_sample_value)};
+        for (const int32_t reset_value : {std::max(3, reset_preset.reset_value / 2), std::min(maximum_reset_value, reset_preset.reset_value * 2)})
+        {
+            if (reset_value != reset_preset.reset_value)
+            {
+                jpegls_pc_parameters preset{reset_preset};
+                preset.reset_value = reset_value;
+                try_candidate(best_transformation, preset);
+            }
+        }
+
+        color_transformation_ = best_transformation;
+        if (!is_same(best_preset, initial_preset))
+        {
+            preset_coding_parameters_ = best_preset;
+        }
+    }
+
+    size_t trial_encode(const uint8_t* source, const uint32_t stride, const charls::color_transformation transformation,
+                        const jpegls_pc_parameters& preset, allocated_vector<uint8_t>& buffer) const
+    {
+        const size_t component_plane_size{static_cast<size_t>(bit_to_byte_count(frame_info_.bits_per_sample)) * frame_info_.width * frame_info_.height};
+        const uint32_t strip_count{std::max(1U, frame_info_.height / trial_strip_distance)};
+
+        size_t size{};
+        for (uint32_t strip = 0; strip < strip_count; ++strip)
+        {
+            const uint32_t first_row{strip * frame_info_.height / strip_count};
+            const uint32_t row_count{std::min(trial_strip_height, frame_info_.height - first_row)};
+            const uint8_t* strip_source{source + static_cast<size_t>(first_row) * stride};
+
+            if (interleave_mode_ == charls::interleave_mode::none)
+            {
+                for (int32_t component = 0; component < frame_info_.component_count; ++component)
+                {
+                    size += trial_encode_strip(strip_source + static_cast<size_t>(component) * component_plane_size, row_count, 1, stride,
+                                               transformation, preset, buffer);
+                }
+            }
+            else
+            {
+                size += trial_encode_strip(strip_source, row_count, frame_info_.component_count, stride, transformation, preset, buffer);
+            }
+        }
+
+        return size;
+    }
+
+    size_t trial_encode_strip(const uint8_t* source, const uint32_t row_count, const int32_t component_count, const uint32_t stride,
+                              const charls::color_transformation transformation, const jpegls_pc_parameters& preset,
+                              allocated_vector<uint8_t>& buffer) const
+    {
+        const charls::frame_info frame_info{frame_info_.width, row_count, frame_info_.bits_per_sample, component_count};
+        auto codec = jls_codec_factory<encoder_strategy>().create_codec(frame_info, {near_lossless_, interleave_mode_, transformation, false}, preset);
+        unique_ptr<process_line> process_line(codec->create_process_line(from_byte_array_const(source, static_cast<size_t>(row_count) * stride), stride));
+        byte_stream_info destination{from_byte_array(buffer.data(), buffer.size())};
+        return codec->encode_scan(move(process_line), destination);
+    }
+
+    // The coded size of a sample is limited by LIMIT (ISO/IEC 14495-1, A.2.1), which is at most 4 times the size of a sample.
+    size_t trial_buffer_size() const noexcept
+    {
+        return static_cast<size_t>(trial_strip_height) * frame_info_.width * static_cast<uint32_t>(frame_info_.component_count) *
+                   bit_to_byte_count(frame_info_.bits_per_sample) * 5 +
+               1024;
+    }
+
+    jpegls_pc_parameters resolve_preset_coding_parameters() const noexcept
+    {
+        const int32_t maximum_sample_value{preset_coding_parameters_.maximum_sample_value != 0
+                                               ? preset_coding_parameters_.maximum_sample_value
+                                               : static_cast<int32_t>(calculate_maximum_sample_value(frame_info_.bits_per_sample))};
+        const jpegls_pc_parameters default_preset{compute_default(maximum_sample_value, near_lossless_)};
+
+        return {maximum_sample_value,
+                preset_coding_parameters_.threshold1 != 0 ? preset_coding_parameters_.threshold1 : default_preset.threshold1,
+                preset_coding_parameters_.threshold2 != 0 ? preset_coding_parameters_.threshold2 : default_preset.threshold2,
+                preset_coding_parameters_.threshold3 != 0 ? preset_coding_parameters_.threshold3 : default_preset.threshold3,
+                preset_coding_parameters_.reset_value != 0 ? preset_coding_parameters_.reset_value : default_preset.reset_value};
+    }
+
+    jpegls_pc_parameters scale_thresholds(const jpegls_pc_parameters& preset, const int32_t numerator, const int32_t denominator) const noexcept
+    {
+        const int32_t maximum_sample_value{preset.maximum_sample_value};
+        jpegls_pc_parameters result{preset};
+        result.threshold1 = std::max(near_lossless_ + 1, std::min(preset.threshold1 * numerator / denominator, maximum_sample_value));
+        result.threshold2 = std::max(result.threshold1, std::min(preset.threshold2 * numerator / denominator, maximum_sample_value));
+        result.threshold3 = std::max(result.threshold2, std::min(preset.threshold3 * numerator / denominator, maximum_sample_value));
+        return result;
+    }
+
+    static bool is_same(const jpegls_pc_parameters& lhs, const jpegls_pc_parameters& rhs) noexcept
+    {
+        return lhs.maximum_sample_value == rhs.maximum_sample_value && lhs.threshold1 == rhs.threshold1 && lhs.threshold2 == rhs.threshold2 &&
+               lhs.threshold3 == rhs.threshold3 && lhs.reset_value == rhs.reset_value;
+    }
+
     charls_frame_info frame_info_{};
     int32_t near_lossless_{};
     charls::interleave_mode interleave_mode_{};
@@ -248,6 +464,11 @@ struct charls_jpegls_encoder final
     state state_{};
     jpeg_stream_writer writer_;
     jpegls_pc_parameters preset_coding_parameters_{};
+    bool collect_scan_statistics_{};
+    allocated_vector<charls::scan_statistics> scan_statistics_;
+    charls::timing_statistics timing_{};
+    bool auto_coding_parameters_{};
+    bool pipelined_encoding_{};
 };
 
 extern "C" {
@@ -280,6 +501,20 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_destination_handler(IN_ charls_jpegls_encoder* encoder,
+                                              IN_ const charls_destination_buffer_handler handler,
+                                              IN_OPT_ void* user_context) noexcept
+try
+{
+    check_pointer(encoder)->destination_handler(check_pointer(handler), user_context);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_encoder_set_frame_info(IN_ charls_jpegls_encoder* encoder,
                                      IN_ const charls_frame_info* frame_info) noexcept
@@ -371,6 +606,69 @@ catch (...)
     return to_jpegls_errc();
 }
 
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_collect_scan_statistics(IN_ charls_jpegls_encoder* encoder, const bool collect) noexcept
+try
+{
+    check_pointer(encoder)->collect_scan_statistics(collect);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_auto_coding_parameters(IN_ charls_jpegls_encoder* encoder, const bool enable) noexcept
+try
+{
+    check_pointer(encoder)->auto_coding_parameters(enable);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_set_pipelined_encoding(IN_ charls_jpegls_encoder* encoder, const bool enable) noexcept
+try
+{
+    check_pointer(encoder)->pipelined_encoding(enable);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_get_scan_statistics(IN_ const charls_jpegls_encoder* encoder,
+                                          const int32_t scan_index,
+                                          OUT_ charls_scan_statistics* scan_statistics) noexcept
+try
+{
+    *check_pointer(scan_statistics) = check_pointer(encoder)->scan_statistics(scan_index);
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
+jpegls_errc CHARLS_API_CALLING_CONVENTION
+charls_jpegls_encoder_get_timing_statistics(IN_ const charls_jpegls_encoder* encoder,
+                                            OUT_ charls_timing_statistics* timing_statistics) noexcept
+try
+{
+    *check_pointer(timing_statistics) = check_pointer(encoder)->timing_statistics();
+    return jpegls_errc::success;
+}
+catch (...)
+{
+    return to_jpegls_errc();
+}
+
 jpegls_errc CHARLS_API_CALLING_CONVENTION
 charls_jpegls_encoder_encode_from_buffer(IN_ charls_jpegls_encoder* encoder,
                                          IN_READS_BYTES_(source_size_bytes) const void* source_buffer,
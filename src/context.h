@@ -11,6 +11,8 @@
 namespace charls {
 
 // Purpose: a JPEG-LS context with it's current statistics.
+// The 365 regular mode contexts (4380 bytes) are accessed in a data dependent order but always fit in the L1 cache.
+// Padding to 16 bytes (no context crosses a cache line) was measured: the times changed by -15% to +22% with no consistent direction.
 struct jls_context final
 {
     int32_t A{};
@@ -99,4 +101,6 @@ struct jls_context final
     }
 };
 
+static_assert(sizeof(jls_context) == 12, "contexts should stay compact to fit the L1 cache");
+
 } // namespace charls
@@ -5,17 +5,134 @@
 
 #include <charls/jpegls_error.h>
 
+#include "allocator.h"
 #include "jpeg_marker_code.h"
 #include "process_line.h"
+#include "timing.h"
 #include "util.h"
 
 #include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace charls {
 
+// Maximum number of bytes that are not yet decoded when the read buffer of a stream is refilled.
+constexpr std::size_t stream_carry_over_size{64};
+
+constexpr std::size_t default_stream_read_buffer_size{64 * 1024};
+constexpr std::size_t minimum_stream_read_buffer_size{1024};
+
+// Reads the next block of a stream on a helper thread, while the decoder decodes the current block.
+// The blocks are stored after a reserved area, the bytes that are not yet decoded are copied in front of the new block.
+class stream_read_ahead final : public allocated_object
+{
+public:
+    stream_read_ahead(std::basic_streambuf<char>* stream, const std::size_t block_size) :
+        stream_{stream},
+        block_size_{block_size},
+        buffers_{allocated_vector<uint8_t>(stream_carry_over_size + block_size), allocated_vector<uint8_t>(stream_carry_over_size + block_size)}
+    {
+        thread_ = std::thread([this]() noexcept { run(); });
+    }
+
+    ~stream_read_ahead()
+    {
+        {
+            const std::lock_guard<std::mutex> lock{mutex_};
+            stop_ = true;
+        }
+        request_condition_.notify_one();
+        thread_.join();
+    }
+
+    stream_read_ahead(const stream_read_ahead&) = delete;
+    stream_read_ahead(stream_read_ahead&&) = delete;
+    stream_read_ahead& operator=(const stream_read_ahead&) = delete;
+    stream_read_ahead& operator=(stream_read_ahead&&) = delete;
+
+    // Waits for the block that is read ahead, copies the carry-over bytes in front of it and starts reading the next block.
+    // Returns the start of the carry-over bytes and sets end to the end of the block, or nullptr at the end of the stream.
+    uint8_t* next_block(const uint8_t* carry_over, const std::size_t carry_over_count, uint8_t*& end)
+    {
+        ASSERT(carry_over_count <= stream_carry_over_size);
+
+        std::unique_lock<std::mutex> lock{mutex_};
+        ready_condition_.wait(lock, [this] { return ready_; });
+        if (exception_)
+            std::rethrow_exception(exception_);
+
+        if (read_count_ == 0)
+            return nullptr;
+
+        uint8_t* block{buffers_[index_].data() + stream_carry_over_size};
+        end = block + read_count_;
+        block -= carry_over_count;
+        if (carry_over_count != 0)
+        {
+            memcpy(block, carry_over, carry_over_count);
+        }
+
+        // The buffer with the carry-over bytes is no longer used by the decoder and can be filled with the next block.
+        index_ ^= 1;
+        ready_ = false;
+        lock.unlock();
+        request_condition_.notify_one();
+
+        return block;
+    }
+
+private:
+    void run() noexcept
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (!stop_)
+        {
+            const std::size_t index{index_};
+            lock.unlock();
+
+            std::streamsize read_count{};
+            std::exception_ptr exception;
+            try
+            {
+                read_count = stream_->sgetn(reinterpret_cast<char*>(buffers_[index].data() + stream_carry_over_size), static_cast<std::streamsize>(block_size_));
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            read_count_ = static_cast<std::size_t>(read_count);
+            exception_ = exception;
+            ready_ = true;
+            ready_condition_.notify_one();
+
+            // Wait until the block is taken. The decoder doesn't take the block at the end of the stream (or after an error).
+            request_condition_.wait(lock, [this] { return !ready_ || stop_; });
+        }
+    }
+
+    std::basic_streambuf<char>* stream_;
+    std::size_t block_size_;
+    allocated_vector<uint8_t> buffers_[2];
+    std::size_t index_{};
+    std::size_t read_count_{};
+    std::exception_ptr exception_;
+    bool ready_{};
+    bool stop_{};
+    std::mutex mutex_;
+    std::condition_variable ready_condition_;
+    std::condition_variable request_condition_;
+    std::thread thread_;
+};
+
 // Purpose: Implements encoding to stream of bits. In encoding mode JpegLsCodec inherits from EncoderStrategy
-class decoder_strategy
+class decoder_strategy : public allocated_object
 {
 public:
     explicit decoder_strategy(const frame_info& frame, const coding_parameters& parameters) noexcept :
@@ -35,6 +152,30 @@ class decoder_strategy
     virtual void set_presets(const jpegls_pc_parameters& preset_coding_parameters) = 0;
     virtual void decode_scan(std::unique_ptr<process_line> output_data, const JlsRect& size, byte_stream_info& compressed_data) = 0;
 
+    // When set, the next scan will store its statistics in the passed structure.
+    void collect_statistics(scan_statistics* statistics) noexcept
+    {
+        statistics_ = statistics;
+    }
+
+    // When set, the next scan will add the time spent in the coding loop and line processing to the passed structure.
+    void collect_timing(timing_statistics* timing) noexcept
+    {
+        timing_ = timing;
+    }
+
+    // When set, the scan continues in the next segments of a scatter-gather source at the end of the passed stream.
+    void source_segments(segment_cursor* segments) noexcept
+    {
+        segments_ = segments;
+    }
+
+    // Sets how the compressed data is read when the source is a stream.
+    void read_options(const stream_read_options& options) noexcept
+    {
+        read_options_ = options;
+    }
+
     void initialize(byte_stream_info& compressed_stream)
     {
         valid_bits_ = 0;
@@ -42,10 +183,20 @@ class decoder_strategy
 
         if (compressed_stream.rawStream)
         {
-            buffer_.resize(40000);
-            position_ = buffer_.data();
-            end_position_ = position_;
+            const std::size_t buffer_size{read_options_.buffer_size == 0 ? default_stream_read_buffer_size : std::max(read_options_.buffer_size, minimum_stream_read_buffer_size)};
             byte_stream_ = compressed_stream.rawStream;
+            if (read_options_.read_ahead)
+            {
+                read_ahead_ = std::make_unique<stream_read_ahead>(byte_stream_, buffer_size);
+                position_ = nullptr;
+            }
+            else
+            {
+                buffer_.resize(buffer_size);
+                position_ = buffer_.data();
+            }
+            end_position_ = position_;
+            next_ff_position_ = position_;
             add_bytes_from_stream();
         }
         else
@@ -61,27 +212,39 @@ class decoder_strategy
 
     void add_bytes_from_stream()
     {
-        if (!byte_stream_ || byte_stream_->sgetc() == std::char_traits<char>::eof())
+        if (!byte_stream_)
             return;
 
-        const auto count = end_position_ - position_;
-
-        if (count > 64)
+        const auto count = static_cast<std::size_t>(end_position_ - position_);
+        if (count > stream_carry_over_size)
             return;
 
-        for (std::size_t i = 0; i < static_cast<std::size_t>(count); ++i)
+        uint8_t* new_position;
+        if (read_ahead_)
         {
-            buffer_[i] = position_[i];
+            new_position = read_ahead_->next_block(position_, count, end_position_);
+            if (!new_position)
+                return;
         }
-        const auto offset = buffer_.data() - position_;
+        else
+        {
+            if (byte_stream_->sgetc() == std::char_traits<char>::eof())
+                return;
 
-        position_ += offset;
-        end_position_ += offset;
-        next_ff_position_ += offset;
+            new_position = buffer_.data();
+            if (count != 0)
+            {
+                memmove(new_position, position_, count);
+            }
+            end_position_ = new_position + count;
+
+            const std::streamsize read_bytes = byte_stream_->sgetn(reinterpret_cast<char*>(end_position_),
+                                                                  static_cast<std::streamsize>(buffer_.size() - count));
+            end_position_ += read_bytes;
+        }
 
-        const std::streamsize read_bytes = byte_stream_->sgetn(reinterpret_cast<char*>(end_position_),
-                                                              static_cast<std::streamsize>(buffer_.size()) - count);
-        end_position_ += read_bytes;
+        next_ff_position_ = new_position + (next_ff_position_ - position_);
+        position_ = new_position;
     }
 
     FORCE_INLINE void skip(const int32_t length) noexcept
@@ -90,22 +253,24 @@ class decoder_strategy
         read_cache_ = read_cache_ << length;
     }
 
-    static void on_line_begin(const size_t /*pixel_count*/, void* /*ptypeBuffer*/, int32_t /*pixelStride*/) noexcept
+    template<typename ProcessLine>
+    static void on_line_begin(ProcessLine& /*process_line*/, const size_t /*pixel_count*/, void* /*ptypeBuffer*/, int32_t /*pixelStride*/) noexcept
     {
     }
 
-    void on_line_end(const size_t pixel_count, const void* source, const int32_t pixel_stride) const
+    template<typename ProcessLine>
+    static void on_line_end(ProcessLine& process_line, const size_t pixel_count, const void* source, const int32_t pixel_stride)
     {
-        process_line_->new_line_decoded(source, pixel_count, pixel_stride);
+        process_line.new_line_decoded(source, pixel_count, pixel_stride);
     }
 
     void end_scan()
     {
-        if (*position_ != jpeg_marker_start_byte)
+        if (current_byte() != jpeg_marker_start_byte)
         {
             read_bit();
 
-            if (*position_ != jpeg_marker_start_byte)
+            if (current_byte() != jpeg_marker_start_byte)
                 impl::throw_jpegls_error(jpegls_errc::too_much_encoded_data);
         }
 
@@ -141,6 +306,9 @@ class decoder_strategy
         {
             if (position_ >= end_position_)
             {
+                if (next_segment())
+                    continue;
+
                 if (valid_bits_ <= 0)
                     impl::throw_jpegls_error(jpegls_errc::invalid_encoded_data);
 
@@ -152,7 +320,8 @@ class decoder_strategy
             if (value_new == jpeg_marker_start_byte)
             {
                 // JPEG bit stream rule: no FF may be followed by 0x80 or higher
-                if (position_ == end_position_ - 1 || (position_[1] & 0x80) != 0)
+                const uint8_t* next_byte{position_ + 1 < end_position_ ? position_ + 1 : first_byte_of_next_segment()};
+                if (!next_byte || (*next_byte & 0x80) != 0)
                 {
                     if (valid_bits_ <= 0)
                         impl::throw_jpegls_error(jpegls_errc::invalid_encoded_data);
@@ -168,6 +337,7 @@ class decoder_strategy
             if (value_new == jpeg_marker_start_byte)
             {
                 --valid_bits_;
+                ++stuffed_bit_count_;
             }
         } while (valid_bits_ < bufType_bit_count - 8);
 
@@ -189,21 +359,43 @@ class decoder_strategy
         return position_next_ff;
     }
 
-    uint8_t* get_cur_byte_pos() const noexcept
+    // Moves the passed stream (and the segment cursor) to the first byte that is not consumed by the scan.
+    void skip_consumed_bytes(byte_stream_info& compressed_stream) const noexcept
     {
+        if (!compressed_stream.rawData)
+            return;
+
         int32_t valid_bits = valid_bits_;
         uint8_t* compressed_bytes = position_;
+        uint8_t* segment_end = end_position_;
 
         for (;;)
         {
+            if (segments_ && compressed_bytes == segments_->segments[segments_->index].data)
+            {
+                // The read cache holds bytes of the previous segment.
+                do
+                {
+                    ASSERT(segments_->index != 0);
+                    --segments_->index;
+                } while (segments_->segments[segments_->index].size == 0);
+
+                const buffer_segment& segment{segments_->segments[segments_->index]};
+                segment_end = static_cast<uint8_t*>(const_cast<void*>(segment.data)) + segment.size;
+                compressed_bytes = segment_end;
+            }
+
             const int32_t last_bits_count = compressed_bytes[-1] == jpeg_marker_start_byte ? 7 : 8;
 
             if (valid_bits < last_bits_count)
-                return compressed_bytes;
+                break;
 
             valid_bits -= last_bits_count;
             --compressed_bytes;
         }
+
+        compressed_stream.rawData = compressed_bytes;
+        compressed_stream.count = static_cast<std::size_t>(segment_end - compressed_bytes);
     }
 
     FORCE_INLINE int32_t read_value(const int32_t length)
@@ -244,41 +436,48 @@ class decoder_strategy
         return set;
     }
 
-    FORCE_INLINE int32_t peek_0_bits()
+    // Returns the number of leading 1 bits (maximum 16), used to process multiple run continuation bits at once.
+    FORCE_INLINE int32_t peek_1_bits()
     {
         if (valid_bits_ < 16)
         {
             make_valid();
         }
-        bufType val_test = read_cache_;
-
-        for (int32_t count = 0; count < 16; ++count)
-        {
-            if ((val_test & (static_cast<bufType>(1) << (bufType_bit_count - 1))) != 0)
-                return count;
 
-            val_test <<= 1;
-        }
-        return -1;
+        const bufType inverted_cache{~read_cache_ | (static_cast<bufType>(1) << (bufType_bit_count - 17))};
+        return count_leading_zeros(inverted_cache);
     }
 
     FORCE_INLINE int32_t read_high_bits()
     {
-        const int32_t count = peek_0_bits();
-        if (count >= 0)
+        if (valid_bits_ < 16)
+        {
+            make_valid();
+        }
+
+        // Note: the cache can contain bits after the valid bits, which may not be consumed yet.
+        const int32_t count{read_cache_ == 0 ? bufType_bit_count : count_leading_zeros(read_cache_)};
+        if (count < valid_bits_)
         {
             skip(count + 1);
             return count;
         }
-        skip(15);
 
-        for (int32_t high_bits_count = 15;; ++high_bits_count)
+        // Prefix longer than the valid bits in the cache (only possible for escape codes or at the end of the data).
+        int32_t high_bits_count{valid_bits_};
+        skip(valid_bits_);
+        for (;; ++high_bits_count)
         {
             if (read_bit())
                 return high_bits_count;
         }
     }
 
+    uint64_t stuffed_bit_count() const noexcept
+    {
+        return stuffed_bit_count_;
+    }
+
     int32_t read_long_value(const int32_t length)
     {
         if (length <= 24)
@@ -287,17 +486,55 @@ class decoder_strategy
         return (read_value(length - 24) << 24) + read_value(24);
     }
 
+private:
+    // Continues with the next segment of a scatter-gather source, the read cache may still hold bits of the current segment.
+    bool next_segment() noexcept
+    {
+        byte_stream_info segment{};
+        if (!segments_ || !segments_->next(segment))
+            return false;
+
+        position_ = segment.rawData;
+        end_position_ = position_ + segment.count;
+        next_ff_position_ = position_;
+        return true;
+    }
+
+    const uint8_t* first_byte_of_next_segment() const noexcept
+    {
+        if (!segments_)
+            return nullptr;
+
+        segment_cursor cursor{*segments_};
+        byte_stream_info segment{};
+        return cursor.next(segment) ? segment.rawData : nullptr;
+    }
+
+    // Returns the byte at the read position, the end of the source is handled as the start of a marker.
+    int32_t current_byte() noexcept
+    {
+        if (position_ == end_position_ && !next_segment())
+            return jpeg_marker_start_byte;
+
+        return *position_;
+    }
+
 protected:
     frame_info frame_info_;
     coding_parameters parameters_;
     std::unique_ptr<process_line> process_line_;
+    scan_statistics* statistics_{};
+    timing_statistics* timing_{};
 
 private:
     using bufType = std::size_t;
     static constexpr auto bufType_bit_count = static_cast<int32_t>(sizeof(bufType) * 8);
 
-    std::vector<uint8_t> buffer_;
+    allocated_vector<uint8_t> buffer_;
     std::basic_streambuf<char>* byte_stream_{};
+    stream_read_options read_options_{};
+    std::unique_ptr<stream_read_ahead> read_ahead_;
+    segment_cursor* segments_{};
 
     // decoding
     bufType read_cache_{};
@@ -305,6 +542,7 @@ class decoder_strategy
     uint8_t* position_{};
     uint8_t* next_ff_position_{};
     uint8_t* end_position_{};
+    uint64_t stuffed_bit_count_{};
 };
 
 } // namespace charls
@@ -5,11 +5,27 @@
 
 #include "decoder_strategy.h"
 #include "process_line.h"
+#include "timing.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace charls {
 
+class encoder_pipeline;
+
+// A code word as emitted by the modeling stage, the bits are right aligned.
+struct encoded_symbol
+{
+    uint32_t bits;
+    int32_t bit_count;
+};
+
 // Purpose: Implements encoding to stream of bits. In encoding mode JpegLsCodec inherits from EncoderStrategy
-class encoder_strategy
+class encoder_strategy : public allocated_object
 {
 public:
     explicit encoder_strategy(const frame_info& frame, const coding_parameters& parameters) noexcept :
@@ -18,7 +34,7 @@ class encoder_strategy
     {
     }
 
-    virtual ~encoder_strategy() = default;
+    virtual ~encoder_strategy();
 
     encoder_strategy(const encoder_strategy&) = delete;
     encoder_strategy(encoder_strategy&&) = delete;
@@ -31,12 +47,38 @@ class encoder_strategy
 
     int32_t peek_byte();
 
-    void on_line_begin(const size_t pixel_count, void* destination, const int32_t pixel_stride) const
+    // When set, the next scan will store its statistics in the passed structure.
+    void collect_statistics(scan_statistics* statistics) noexcept
     {
-        process_line_->new_line_requested(destination, pixel_count, pixel_stride);
+        statistics_ = statistics;
     }
 
-    static void on_line_end(size_t /*pixel_count*/, void* /*destination*/, int32_t /*pixel_stride*/) noexcept
+    // When set, the next scan will add the time spent in the coding loop and line processing to the passed structure.
+    void collect_timing(timing_statistics* timing) noexcept
+    {
+        timing_ = timing;
+    }
+
+    // When set, the bit stream of the next scans is written by a second thread, while the calling thread does the modeling.
+    void pipelined(const bool enable) noexcept
+    {
+        pipelined_ = enable;
+    }
+
+    // When set, the scan continues in the next buffers of the chain when the passed output stream is full.
+    void destination_buffers(destination_chain* chain) noexcept
+    {
+        destination_chain_ = chain;
+    }
+
+    template<typename ProcessLine>
+    static void on_line_begin(ProcessLine& process_line, const size_t pixel_count, void* destination, const int32_t pixel_stride)
+    {
+        process_line.new_line_requested(destination, pixel_count, pixel_stride);
+    }
+
+    template<typename ProcessLine>
+    static void on_line_end(ProcessLine& /*process_line*/, size_t /*pixel_count*/, void* /*destination*/, int32_t /*pixel_stride*/) noexcept
     {
     }
 
@@ -58,6 +100,11 @@ class encoder_strategy
             position_ = compressed_stream.rawData;
             compressed_length_ = compressed_stream.count;
         }
+
+        if (pipelined_)
+        {
+            start_pipeline(compressed_stream);
+        }
     }
 
     void append_to_bit_stream(const uint32_t bits, const int32_t bit_count)
@@ -69,6 +116,16 @@ class encoder_strategy
         ASSERT((bits | mask) == mask); // Not used bits must be set to zero.
 #endif
 
+        if (symbol_position_)
+        {
+            *symbol_position_ = {bits, bit_count};
+            if (++symbol_position_ == symbol_end_)
+            {
+                submit_symbols();
+            }
+            return;
+        }
+
         free_bit_count_ -= bit_count;
         if (free_bit_count_ >= 0)
         {
@@ -94,6 +151,11 @@ class encoder_strategy
 
     void end_scan()
     {
+        if (pipeline_)
+        {
+            finish_pipeline();
+        }
+
         flush();
 
         // if a 0xff was written, Flush() will force one unset bit anyway
@@ -134,6 +196,12 @@ class encoder_strategy
     {
         if (compressed_length_ < 4)
         {
+            if (destination_chain_)
+            {
+                flush_into_chain();
+                return;
+            }
+
             overflow();
         }
 
@@ -142,25 +210,53 @@ class encoder_strategy
             if (free_bit_count_ >= 32)
                 break;
 
-            if (is_ff_written_)
-            {
-                // JPEG-LS requirement (T.87, A.1) to detect markers: after a xFF value a single 0 bit needs to be inserted.
-                *position_ = static_cast<uint8_t>(bit_buffer_ >> 25);
-                bit_buffer_ = bit_buffer_ << 7;
-                free_bit_count_ += 7;
-            }
-            else
+            write_byte();
+        }
+    }
+
+    // Variant of flush for the end of a buffer of a destination chain: the buffer is filled completely before the next is used.
+    void flush_into_chain()
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (free_bit_count_ >= 32)
+                break;
+
+            if (compressed_length_ == 0)
             {
-                *position_ = static_cast<uint8_t>(bit_buffer_ >> 24);
-                bit_buffer_ = bit_buffer_ << 8;
-                free_bit_count_ += 8;
+                destination_chain_->next();
+                position_ = destination_chain_->buffer.rawData;
+                compressed_length_ = destination_chain_->buffer.count;
             }
 
-            is_ff_written_ = *position_ == jpeg_marker_start_byte;
-            ++position_;
-            --compressed_length_;
-            ++bytes_written_;
+            write_byte();
+        }
+    }
+
+    FORCE_INLINE void write_byte() noexcept
+    {
+        if (is_ff_written_)
+        {
+            // JPEG-LS requirement (T.87, A.1) to detect markers: after a xFF value a single 0 bit needs to be inserted.
+            *position_ = static_cast<uint8_t>(bit_buffer_ >> 25);
+            bit_buffer_ = bit_buffer_ << 7;
+            free_bit_count_ += 7;
+        }
+        else
+        {
+            *position_ = static_cast<uint8_t>(bit_buffer_ >> 24);
+            bit_buffer_ = bit_buffer_ << 8;
+            free_bit_count_ += 8;
+        }
+
+        is_ff_written_ = *position_ == jpeg_marker_start_byte;
+        if (is_ff_written_)
+        {
+            ++stuffed_bit_count_;
         }
+        ++position_;
+        --compressed_length_;
+        ++bytes_written_;
     }
 
     std::size_t get_length() const noexcept
@@ -168,6 +264,11 @@ class encoder_strategy
         return bytes_written_ - (static_cast<uint32_t>(free_bit_count_) - 32U) / 8U;
     }
 
+    uint64_t stuffed_bit_count() const noexcept
+    {
+        return stuffed_bit_count_;
+    }
+
     FORCE_INLINE void append_ones_to_bit_stream(const int32_t length)
     {
         append_to_bit_stream((1 << length) - 1, length);
@@ -177,8 +278,14 @@ class encoder_strategy
     coding_parameters parameters_;
     std::unique_ptr<decoder_strategy> decoder_;
     std::unique_ptr<process_line> process_line_;
+    scan_statistics* statistics_{};
+    timing_statistics* timing_{};
 
 private:
+    void start_pipeline(byte_stream_info& compressed_stream);
+    void submit_symbols();
+    void finish_pipeline();
+
     unsigned int bit_buffer_{};
     int32_t free_bit_count_{sizeof bit_buffer_ * 8};
     std::size_t compressed_length_{};
@@ -187,9 +294,248 @@ class encoder_strategy
     uint8_t* position_{};
     bool is_ff_written_{};
     std::size_t bytes_written_{};
+    uint64_t stuffed_bit_count_{};
 
-    std::vector<uint8_t> buffer_;
+    allocated_vector<uint8_t> buffer_;
     std::basic_streambuf<char>* compressed_stream_{};
+    destination_chain* destination_chain_{};
+
+    // pipelined encoding: the symbols are collected in batches, which are written by the packing thread of the pipeline.
+    bool pipelined_{};
+    encoded_symbol* symbol_position_{};
+    encoded_symbol* symbol_end_{};
+    std::unique_ptr<encoder_pipeline> pipeline_;
 };
 
+
+// Single producer, single consumer ring of symbol batches. The modeling thread fills the batches, the packing thread
+// writes them to the bit stream with its own bit writer (a second encoder_strategy). The two threads only share the
+// batches and the atomic counters, the bit writer state is not touched by the modeling thread until the pipeline is finished.
+// A thread that has to wait spins a short time (a batch is usually handed over quickly) and then blocks on a condition variable.
+class encoder_pipeline final : public allocated_object
+{
+public:
+    static constexpr size_t batch_count{8};
+    static constexpr size_t batch_size{4096};
+    static constexpr int32_t spin_count{1000};
+
+    encoder_pipeline(byte_stream_info& compressed_stream, destination_chain* chain) :
+        batches_(batch_count * batch_size)
+    {
+        packer_.start(compressed_stream, chain);
+        thread_ = std::thread([this]() noexcept { run(); });
+    }
+
+    ~encoder_pipeline()
+    {
+        if (thread_.joinable())
+        {
+            stop_ = true;
+            notify(produced_condition_);
+            thread_.join();
+        }
+    }
+
+    encoder_pipeline(const encoder_pipeline&) = delete;
+    encoder_pipeline(encoder_pipeline&&) = delete;
+    encoder_pipeline& operator=(const encoder_pipeline&) = delete;
+    encoder_pipeline& operator=(encoder_pipeline&&) = delete;
+
+    encoded_symbol* batch_begin() noexcept
+    {
+        return &batches_[(produced_count_.load(std::memory_order_relaxed) % batch_count) * batch_size];
+    }
+
+    // Hands the current batch to the packing thread and waits until the next batch is free.
+    encoded_symbol* submit(const size_t symbol_count)
+    {
+        const size_t produced_count{produced_count_.load(std::memory_order_relaxed)};
+        symbol_counts_[produced_count % batch_count] = symbol_count;
+        produced_count_.store(produced_count + 1, std::memory_order_release);
+        notify(produced_condition_);
+
+        wait(consumed_condition_, [this, produced_count] {
+            return produced_count + 1 - consumed_count_.load(std::memory_order_acquire) != batch_count || failed_.load(std::memory_order_acquire);
+        });
+        if (failed_.load(std::memory_order_acquire))
+        {
+            join();
+        }
+
+        return batch_begin();
+    }
+
+    // Submits the last (partial) batch, waits until all batches are written and returns the bit writer.
+    encoder_strategy& finish(const size_t symbol_count)
+    {
+        submit(symbol_count);
+        done_ = true;
+        notify(produced_condition_);
+        join();
+        return packer_;
+    }
+
+private:
+    class bit_packer final : public encoder_strategy
+    {
+    public:
+        bit_packer() noexcept :
+            encoder_strategy({}, {})
+        {
+        }
+
+        void start(byte_stream_info& compressed_stream, destination_chain* chain)
+        {
+            destination_buffers(chain);
+            initialize(compressed_stream);
+        }
+
+        void write(const encoded_symbol* symbols, const size_t symbol_count)
+        {
+            for (size_t i{}; i != symbol_count; ++i)
+            {
+                append_to_bit_stream(symbols[i].bits, symbols[i].bit_count);
+            }
+        }
+
+        std::unique_ptr<process_line> create_process_line(byte_stream_info /*stream_info*/, uint32_t /*stride*/) override
+        {
+            return {};
+        }
+
+        void set_presets(const jpegls_pc_parameters& /*preset_coding_parameters*/) noexcept override
+        {
+        }
+
+        size_t encode_scan(std::unique_ptr<process_line> /*raw_data*/, byte_stream_info& /*compressed_data*/) noexcept override
+        {
+            return 0;
+        }
+    };
+
+    void run() noexcept
+    {
+        try
+        {
+            size_t consumed_count{};
+            for (;;)
+            {
+                wait(produced_condition_, [this, consumed_count] {
+                    return produced_count_.load(std::memory_order_acquire) != consumed_count || done_ || stop_;
+                });
+
+                const size_t produced_count{produced_count_.load(std::memory_order_acquire)};
+                if (consumed_count == produced_count)
+                    return;
+
+                for (; consumed_count != produced_count && !stop_; ++consumed_count)
+                {
+                    const size_t index{consumed_count % batch_count};
+                    packer_.write(&batches_[index * batch_size], symbol_counts_[index]);
+                    consumed_count_.store(consumed_count + 1, std::memory_order_release);
+                    notify(consumed_condition_);
+                }
+            }
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+            failed_ = true;
+            notify(consumed_condition_);
+        }
+    }
+
+    template<typename Predicate>
+    void wait(std::condition_variable& condition, Predicate predicate)
+    {
+        for (int32_t i{}; i != spin_count; ++i)
+        {
+            if (predicate())
+                return;
+        }
+
+        std::unique_lock<std::mutex> lock{mutex_};
+        condition.wait(lock, predicate);
+    }
+
+    // The mutex is taken after the shared state is changed: a thread that is about to block will see the change or the notification.
+    void notify(std::condition_variable& condition)
+    {
+        {
+            const std::lock_guard<std::mutex> lock{mutex_};
+        }
+        condition.notify_one();
+    }
+
+    // Waits for the packing thread and passes its exception (destination buffer too small) to the modeling thread.
+    void join()
+    {
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        if (exception_)
+            std::rethrow_exception(exception_);
+    }
+
+    allocated_vector<encoded_symbol> batches_;
+    size_t symbol_counts_[batch_count]{};
+    bit_packer packer_;
+    std::thread thread_;
+    std::exception_ptr exception_;
+
+    // The counters are kept on separate cache lines: each thread writes one and reads the other.
+    static constexpr size_t cache_line_size{64};
+    char padding0_[cache_line_size]{};
+    std::atomic<size_t> produced_count_{};
+    char padding1_[cache_line_size]{};
+    std::atomic<size_t> consumed_count_{};
+    char padding2_[cache_line_size]{};
+    std::atomic<bool> done_{};
+    std::atomic<bool> stop_{};
+    std::atomic<bool> failed_{};
+    std::mutex mutex_;
+    std::condition_variable produced_condition_;
+    std::condition_variable consumed_condition_;
+};
+
+
+inline encoder_strategy::~encoder_strategy() = default;
+
+
+inline void encoder_strategy::start_pipeline(byte_stream_info& compressed_stream)
+{
+    pipeline_ = std::make_unique<encoder_pipeline>(compressed_stream, destination_chain_);
+    symbol_position_ = pipeline_->batch_begin();
+    symbol_end_ = symbol_position_ + encoder_pipeline::batch_size;
+}
+
+
+inline void encoder_strategy::submit_symbols()
+{
+    symbol_position_ = pipeline_->submit(encoder_pipeline::batch_size);
+    symbol_end_ = symbol_position_ + encoder_pipeline::batch_size;
+}
+
+
+inline void encoder_strategy::finish_pipeline()
+{
+    const auto symbol_count = static_cast<size_t>(symbol_position_ - (symbol_end_ - encoder_pipeline::batch_size));
+    symbol_position_ = nullptr;
+    symbol_end_ = nullptr;
+
+    // Continue with the state of the bit writer of the packing thread, to write the end of the scan.
+    encoder_strategy& packer{pipeline_->finish(symbol_count)};
+    bit_buffer_ = packer.bit_buffer_;
+    free_bit_count_ = packer.free_bit_count_;
+    compressed_length_ = packer.compressed_length_;
+    position_ = packer.position_;
+    is_ff_written_ = packer.is_ff_written_;
+    bytes_written_ = packer.bytes_written_;
+    stuffed_bit_count_ = packer.stuffed_bit_count_;
+    buffer_.swap(packer.buffer_);
+    compressed_stream_ = packer.compressed_stream_;
+    pipeline_.reset();
+}
+
 } // namespace charls
@@ -151,11 +151,18 @@ jpegls_errc JpegLsEncodeStream(const byte_stream_info destination, size_t& bytes
 }
 
 
-jpegls_errc JpegLsDecodeStream(const byte_stream_info destination, const byte_stream_info source, const JlsParameters* /*params*/)
+jpegls_errc JpegLsDecodeStream(const byte_stream_info destination, const byte_stream_info source, const JlsParameters* params)
+{
+    return JpegLsDecodeStream(destination, source, params, stream_read_options{});
+}
+
+
+jpegls_errc JpegLsDecodeStream(const byte_stream_info destination, const byte_stream_info source, const JlsParameters* /*params*/, const stream_read_options& options)
 {
     try
     {
         jpeg_stream_reader reader{source};
+        reader.read_options(options);
 
         reader.read_header();
         reader.read_start_of_scan();
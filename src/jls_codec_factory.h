@@ -5,6 +5,7 @@
 
 #include "coding_parameters.h"
 
+#include <cstddef>
 #include <memory>
 
 
@@ -19,6 +20,10 @@ class jls_codec_factory final
 public:
     std::unique_ptr<Strategy> create_codec(const frame_info& frame, const coding_parameters& parameters, const jpegls_pc_parameters& preset_coding_parameters);
 
+    // Sizes in bytes of the largest codec and process line objects, used to compute the size of a workspace.
+    static std::size_t maximum_codec_size() noexcept;
+    static std::size_t maximum_process_line_size() noexcept;
+
 private:
     std::unique_ptr<Strategy> create_optimized_codec(const frame_info& frame, const coding_parameters& parameters);
 };
@@ -9,16 +9,16 @@
 #include "jls_codec_factory.h"
 #include "jpeg_marker_code.h"
 #include "jpegls_preset_parameters_type.h"
+#include "timing.h"
 #include "util.h"
 
-#include <algorithm>
+#include <array>
 #include <iomanip>
 #include <memory>
 
 using charls::impl::throw_jpegls_error;
-using std::find;
+using std::array;
 using std::unique_ptr;
-using std::vector;
 
 namespace charls {
 
@@ -28,6 +28,16 @@ jpeg_stream_reader::jpeg_stream_reader(byte_stream_info byte_stream_info) noexce
 }
 
 
+jpeg_stream_reader::jpeg_stream_reader(const buffer_segment* segments, const size_t segment_count) :
+    byte_stream_{}, segments_(segments, segments + segment_count), segment_cursor_{segments_.data(), segments_.size(), 0}
+{
+    if (!segments_.empty())
+    {
+        byte_stream_ = from_byte_array_const(segments_[0].data, segments_[0].size);
+    }
+}
+
+
 void jpeg_stream_reader::read(byte_stream_info source, uint32_t stride)
 {
     ASSERT(state_ == state::bit_stream_section);
@@ -52,6 +62,18 @@ void jpeg_stream_reader::read(byte_stream_info source, uint32_t stride)
     if (source.rawData && static_cast<int64_t>(source.count) < bytes_per_plane * frame_info_.component_count)
         throw_jpegls_error(jpegls_errc::destination_buffer_too_small);
 
+    // Report the times of this call only: the header that was read before it is included, the scans of a previous call are not.
+    const uint64_t read_header_nanoseconds{state_ == state::bit_stream_section ? timing_.read_header_nanoseconds : 0};
+    timing_ = {};
+    timing_.read_header_nanoseconds = read_header_nanoseconds;
+
+    scan_statistics_.clear();
+    if (collect_scan_statistics_)
+    {
+        // A frame has at most one scan per component. Reserving keeps the statistics at a fixed position in a workspace.
+        scan_statistics_.reserve(static_cast<size_t>(frame_info_.component_count));
+    }
+
     int component_index{};
     while (component_index < frame_info_.component_count)
     {
@@ -60,7 +82,28 @@ void jpeg_stream_reader::read(byte_stream_info source, uint32_t stride)
             read_next_start_of_scan();
         }
 
-        unique_ptr<decoder_strategy> codec = jls_codec_factory<decoder_strategy>().create_codec(frame_info_, parameters_, preset_coding_parameters_);
+        unique_ptr<decoder_strategy> codec;
+        {
+            const scoped_timer timer{&timing_, &charls::timing_statistics::create_codec_nanoseconds};
+            codec = jls_codec_factory<decoder_strategy>().create_codec(frame_info_, parameters_, preset_coding_parameters_);
+        }
+        codec->collect_timing(&timing_);
+
+        if (collect_scan_statistics_)
+        {
+            scan_statistics_.emplace_back();
+            codec->collect_statistics(&scan_statistics_.back());
+        }
+
+        if (!segments_.empty())
+        {
+            codec->source_segments(&segment_cursor_);
+        }
+        else if (byte_stream_.rawStream)
+        {
+            codec->read_options(read_options_);
+        }
+
         unique_ptr<process_line> process_line(codec->create_process_line(source, stride));
         codec->decode_scan(move(process_line), rect_, byte_stream_);
         skip_bytes(source, static_cast<size_t>(bytes_per_plane));
@@ -74,11 +117,11 @@ void jpeg_stream_reader::read(byte_stream_info source, uint32_t stride)
 }
 
 
-void jpeg_stream_reader::read_bytes(std::vector<char>& destination, const int byte_count)
+void jpeg_stream_reader::read_bytes(char* destination, const int byte_count)
 {
     for (int i = 0; i < byte_count; ++i)
     {
-        destination.push_back(static_cast<char>(read_byte()));
+        destination[i] = static_cast<char>(read_byte());
     }
 }
 
@@ -86,6 +129,7 @@ void jpeg_stream_reader::read_bytes(std::vector<char>& destination, const int by
 void jpeg_stream_reader::read_header(spiff_header* header, bool* spiff_header_found)
 {
     ASSERT(state_ != state::scan_section);
+    const scoped_timer timer{&timing_, &charls::timing_statistics::read_header_nanoseconds};
 
     if (state_ == state::before_start_of_image)
     {
@@ -406,6 +450,8 @@ int jpeg_stream_reader::read_preset_parameters_segment(const int32_t segment_siz
 
 void jpeg_stream_reader::read_start_of_scan()
 {
+    const scoped_timer timer{&timing_, &charls::timing_statistics::read_header_nanoseconds};
+
     const int32_t segment_size = read_segment_size();
     if (segment_size < 6)
         throw_jpegls_error(jpegls_errc::invalid_marker_segment_size);
@@ -444,7 +490,7 @@ uint8_t jpeg_stream_reader::read_byte()
     if (byte_stream_.rawStream)
         return static_cast<uint8_t>(byte_stream_.rawStream->sbumpc());
 
-    if (byte_stream_.count == 0)
+    if (byte_stream_.count == 0 && !segment_cursor_.next(byte_stream_))
         throw_jpegls_error(jpegls_errc::source_buffer_too_small);
 
     const uint8_t value = byte_stream_.rawData[0];
@@ -505,8 +551,8 @@ int jpeg_stream_reader::try_read_application_data8_segment(const int32_t segment
 
 int jpeg_stream_reader::try_read_hp_color_transform_segment()
 {
-    vector<char> source_tag;
-    read_bytes(source_tag, 4);
+    array<char, 4> source_tag;
+    read_bytes(source_tag.data(), static_cast<int>(source_tag.size()));
     if (strncmp(source_tag.data(), "mrfx", 4) != 0) // mrfx = xfrm (in big endian) = colorXFoRM
         return 4;
 
@@ -543,8 +589,8 @@ EnumType enum_cast(uint8_t value)
 
 int jpeg_stream_reader::try_read_spiff_header_segment(OUT_ spiff_header& header, OUT_ bool& spiff_header_found)
 {
-    vector<char> source_tag;
-    read_bytes(source_tag, 6);
+    array<char, 6> source_tag;
+    read_bytes(source_tag.data(), static_cast<int>(source_tag.size()));
     if (strncmp(source_tag.data(), "SPIFF\0", 6) != 0)
     {
         header = {};
@@ -580,10 +626,10 @@ int jpeg_stream_reader::try_read_spiff_header_segment(OUT_ spiff_header& header,
 
 void jpeg_stream_reader::add_component(const uint8_t component_id)
 {
-    if (find(component_ids_.cbegin(), component_ids_.cend(), component_id) != component_ids_.cend())
+    if (component_ids_[component_id])
         throw_jpegls_error(jpegls_errc::duplicate_component_id_in_sof_segment);
 
-    component_ids_.push_back(component_id);
+    component_ids_.set(component_id);
 }
 
 
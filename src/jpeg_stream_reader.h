@@ -6,20 +6,23 @@
 #include <charls/charls_legacy.h>
 #include <charls/public_types.h>
 
+#include "allocator.h"
 #include "coding_parameters.h"
+#include "util.h"
 
+#include <bitset>
 #include <cstdint>
-#include <vector>
 
 namespace charls {
 
 enum class jpeg_marker_code : uint8_t;
 
 // Purpose: minimal implementation to read a JPEG byte stream.
-class jpeg_stream_reader final
+class jpeg_stream_reader final : public allocated_object
 {
 public:
     explicit jpeg_stream_reader(byte_stream_info byte_stream_info) noexcept;
+    jpeg_stream_reader(const buffer_segment* segments, std::size_t segment_count);
 
     const charls::frame_info& frame_info() const noexcept
     {
@@ -49,6 +52,26 @@ class jpeg_stream_reader final
         rect_ = rect;
     }
 
+    void read_options(const stream_read_options& options) noexcept
+    {
+        read_options_ = options;
+    }
+
+    void collect_scan_statistics(const bool collect) noexcept
+    {
+        collect_scan_statistics_ = collect;
+    }
+
+    const allocated_vector<charls::scan_statistics>& scan_statistics() const noexcept
+    {
+        return scan_statistics_;
+    }
+
+    const charls::timing_statistics& timing_statistics() const noexcept
+    {
+        return timing_;
+    }
+
     void read_start_of_scan();
     uint8_t read_byte();
 
@@ -57,7 +80,7 @@ class jpeg_stream_reader final
     uint16_t read_uint16();
     uint32_t read_uint32();
     int32_t read_segment_size();
-    void read_bytes(std::vector<char>& destination, int byte_count);
+    void read_bytes(char* destination, int byte_count);
     void read_next_start_of_scan();
     jpeg_marker_code read_next_marker_code();
     void validate_marker_code(jpeg_marker_code marker_code) const;
@@ -88,12 +111,18 @@ class jpeg_stream_reader final
     };
 
     byte_stream_info byte_stream_;
+    allocated_vector<buffer_segment> segments_;
+    segment_cursor segment_cursor_{};
+    stream_read_options read_options_{};
     charls::frame_info frame_info_{};
     coding_parameters parameters_{};
     jpegls_pc_parameters preset_coding_parameters_{};
     JlsRect rect_{};
-    std::vector<uint8_t> component_ids_;
+    std::bitset<256> component_ids_;
     state state_{};
+    bool collect_scan_statistics_{};
+    allocated_vector<charls::scan_statistics> scan_statistics_;
+    charls::timing_statistics timing_{};
 };
 
 } // namespace charls
@@ -11,10 +11,8 @@
 
 #include <array>
 #include <cassert>
-#include <vector>
 
 using std::array;
-using std::vector;
 
 namespace charls {
 
@@ -42,7 +40,7 @@ void jpeg_stream_writer::write_spiff_header_segment(const spiff_header& header)
     ASSERT(header.width > 0);
 
     // Create a JPEG APP8 segment in Still Picture Interchange File Format (SPIFF), v2.0
-    vector<uint8_t> segment{'S', 'P', 'I', 'F', 'F', '\0'};
+    allocated_vector<uint8_t> segment{'S', 'P', 'I', 'F', 'F', '\0'};
     segment.push_back(spiff_major_revision_number);
     segment.push_back(spiff_minor_revision_number);
     segment.push_back(static_cast<uint8_t>(header.profile_id));
@@ -90,7 +88,7 @@ void jpeg_stream_writer::write_start_of_frame_segment(const uint32_t width, cons
     ASSERT(component_count > 0 && component_count <= UINT8_MAX);
 
     // Create a Frame Header as defined in ISO/IEC 14495-1, C.2.2 and T.81, B.2.2
-    vector<uint8_t> segment;
+    allocated_vector<uint8_t> segment;
     segment.push_back(static_cast<uint8_t>(bits_per_sample)); // P = Sample precision
     push_back(segment, static_cast<uint16_t>(height));      // Y = Number of lines
     push_back(segment, static_cast<uint16_t>(width));       // X = Number of samples per line
@@ -121,7 +119,7 @@ void jpeg_stream_writer::write_color_transform_segment(const color_transformatio
 
 void jpeg_stream_writer::write_jpegls_preset_parameters_segment(const jpegls_pc_parameters& preset_coding_parameters)
 {
-    vector<uint8_t> segment;
+    allocated_vector<uint8_t> segment;
 
     segment.push_back(static_cast<uint8_t>(jpegls_preset_parameters_type::preset_coding_parameters));
 
@@ -146,7 +144,7 @@ void jpeg_stream_writer::write_start_of_scan_segment(const int component_count,
            interleave_mode == interleave_mode::sample);
 
     // Create a Scan Header as defined in T.87, C.2.3 and T.81, B.2.3
-    vector<uint8_t> segment;
+    allocated_vector<uint8_t> segment;
 
     segment.push_back(static_cast<uint8_t>(component_count));
     for (auto i = 0; i < component_count; ++i)
@@ -6,9 +6,10 @@
 #include <charls/charls_legacy.h>
 #include <charls/jpegls_error.h>
 
+#include "allocator.h"
 #include "jpeg_marker_code.h"
+#include "util.h"
 
-#include <vector>
 
 namespace charls {
 
@@ -71,7 +72,7 @@ class jpeg_stream_writer final
 
     std::size_t bytes_written() const noexcept
     {
-        return byte_offset_;
+        return buffer_start_ + byte_offset_;
     }
 
     std::size_t get_length() const noexcept
@@ -92,6 +93,16 @@ class jpeg_stream_writer final
         if (destination_.rawStream)
             return;
 
+        if (chain_.handler)
+        {
+            // The scan may have continued in the next buffers of the chain.
+            const std::size_t position{buffer_start_ + byte_offset_ + byte_count};
+            destination_ = chain_.buffer;
+            buffer_start_ = chain_.previous_bytes;
+            byte_offset_ = position - buffer_start_;
+            return;
+        }
+
         byte_offset_ += byte_count;
     }
 
@@ -102,6 +113,18 @@ class jpeg_stream_writer final
         destination_.count = destination_size;
     }
 
+    void update_destination(const destination_buffer_handler handler, void* user_context) noexcept
+    {
+        chain_ = {handler, user_context, {}, 0};
+        destination_ = {};
+    }
+
+    // The chain of destination buffers that the scan continues in when the output stream is full, or nullptr.
+    destination_chain* chain() noexcept
+    {
+        return chain_.handler ? &chain_ : nullptr;
+    }
+
 private:
     uint8_t* get_pos() const noexcept
     {
@@ -119,13 +142,26 @@ class jpeg_stream_writer final
         else
         {
             if (byte_offset_ >= destination_.count)
-                impl::throw_jpegls_error(jpegls_errc::destination_buffer_too_small);
+            {
+                next_destination_buffer();
+            }
 
             destination_.rawData[byte_offset_++] = value;
         }
     }
 
-    void write_bytes(const std::vector<uint8_t>& bytes)
+    void next_destination_buffer()
+    {
+        if (!chain_.handler)
+            impl::throw_jpegls_error(jpegls_errc::destination_buffer_too_small);
+
+        chain_.next();
+        destination_ = chain_.buffer;
+        buffer_start_ = chain_.previous_bytes;
+        byte_offset_ = 0;
+    }
+
+    void write_bytes(const allocated_vector<uint8_t>& bytes)
     {
         for (const auto value : bytes)
         {
@@ -165,6 +201,8 @@ class jpeg_stream_writer final
 
     byte_stream_info destination_{};
     std::size_t byte_offset_{};
+    std::size_t buffer_start_{};
+    destination_chain chain_{};
     int8_t component_id_{1};
 };
 
@@ -9,9 +9,11 @@
 #include "jpegls_preset_coding_parameters.h"
 #include "lookup_table.h"
 #include "lossless_traits.h"
+#include "near_lossless_traits.h"
 #include "scan.h"
 #include "util.h"
 
+#include <algorithm>
 #include <array>
 #include <vector>
 
@@ -60,6 +62,83 @@ unique_ptr<Strategy> make_codec(const Traits& traits, const frame_info& frame_in
     return make_unique<charls::jls_codec<Traits, Strategy>>(traits, frame_info, parameters);
 }
 
+template<typename Strategy, typename SampleType, int32_t BitsPerPixel>
+unique_ptr<Strategy> make_near_lossless_codec(const frame_info& frame_info, const coding_parameters& parameters)
+{
+    switch (parameters.near_lossless)
+    {
+    case 1:
+        return make_codec<Strategy>(near_lossless_traits<SampleType, BitsPerPixel, 1>(), frame_info, parameters);
+    case 2:
+        return make_codec<Strategy>(near_lossless_traits<SampleType, BitsPerPixel, 2>(), frame_info, parameters);
+    case 3:
+        return make_codec<Strategy>(near_lossless_traits<SampleType, BitsPerPixel, 3>(), frame_info, parameters);
+    default:
+        return nullptr;
+    }
+}
+
+template<typename Strategy, typename SampleType, typename PixelType>
+unique_ptr<Strategy> make_default_codec(const frame_info& frame_info, const coding_parameters& parameters, const jpegls_pc_parameters& preset_coding_parameters)
+{
+    default_traits<SampleType, PixelType> traits(static_cast<int32_t>(calculate_maximum_sample_value(frame_info.bits_per_sample)), parameters.near_lossless, preset_coding_parameters.reset_value);
+    if (preset_coding_parameters.maximum_sample_value != 0)
+    {
+        // A value of 0 selects the default maximum sample value.
+        traits.maximum_sample_value = preset_coding_parameters.maximum_sample_value;
+    }
+    return make_codec<Strategy>(traits, frame_info, parameters);
+}
+
+// The pixel type must match the interleave mode: in sample interleaved mode all components of a pixel are coded together.
+template<typename Strategy, typename SampleType>
+unique_ptr<Strategy> make_default_codec(const frame_info& frame_info, const coding_parameters& parameters, const jpegls_pc_parameters& preset_coding_parameters)
+{
+    if (parameters.interleave_mode == interleave_mode::sample)
+    {
+        if (frame_info.component_count == 3)
+            return make_default_codec<Strategy, SampleType, triplet<SampleType>>(frame_info, parameters, preset_coding_parameters);
+
+        if (frame_info.component_count == 4)
+            return make_default_codec<Strategy, SampleType, quad<SampleType>>(frame_info, parameters, preset_coding_parameters);
+    }
+
+    return make_default_codec<Strategy, SampleType, SampleType>(frame_info, parameters, preset_coding_parameters);
+}
+
+template<typename T>
+constexpr size_t maximum_size() noexcept
+{
+    return sizeof(T);
+}
+
+template<typename T1, typename T2, typename... Types>
+constexpr size_t maximum_size() noexcept
+{
+    return sizeof(T1) > maximum_size<T2, Types...>() ? sizeof(T1) : maximum_size<T2, Types...>();
+}
+
+template<typename Strategy, typename SampleType>
+constexpr size_t maximum_codec_size() noexcept
+{
+    return maximum_size<jls_codec<default_traits<SampleType, SampleType>, Strategy>,
+                        jls_codec<default_traits<SampleType, triplet<SampleType>>, Strategy>,
+                        jls_codec<default_traits<SampleType, quad<SampleType>>, Strategy>,
+                        jls_codec<lossless_traits<SampleType, 8>, Strategy>,
+                        jls_codec<lossless_traits<triplet<SampleType>, 8>, Strategy>,
+                        jls_codec<lossless_traits<quad<SampleType>, 8>, Strategy>,
+                        jls_codec<near_lossless_traits<SampleType, 8, 3>, Strategy>>();
+}
+
+template<typename SampleType>
+constexpr size_t maximum_process_line_size() noexcept
+{
+    return maximum_size<process_transformed<transform_none<SampleType>>,
+                        process_transformed<transform_hp1<SampleType>>,
+                        process_transformed<transform_hp2<SampleType>>,
+                        process_transformed<transform_hp3<SampleType>>>();
+}
+
 } // namespace
 
 
@@ -95,15 +174,11 @@ unique_ptr<Strategy> jls_codec_factory<Strategy>::create_codec(const frame_info&
     {
         if (frame.bits_per_sample <= 8)
         {
-            default_traits<uint8_t, uint8_t> traits(static_cast<int32_t>(calculate_maximum_sample_value(frame.bits_per_sample)), parameters.near_lossless, preset_coding_parameters.reset_value);
-            traits.maximum_sample_value = preset_coding_parameters.maximum_sample_value;
-            codec = make_unique<jls_codec<default_traits<uint8_t, uint8_t>, Strategy>>(traits, frame, parameters);
+            codec = make_default_codec<Strategy, uint8_t>(frame, parameters, preset_coding_parameters);
         }
         else
         {
-            default_traits<uint16_t, uint16_t> traits(static_cast<int32_t>(calculate_maximum_sample_value(frame.bits_per_sample)), parameters.near_lossless, preset_coding_parameters.reset_value);
-            traits.maximum_sample_value = preset_coding_parameters.maximum_sample_value;
-            codec = make_unique<jls_codec<default_traits<uint16_t, uint16_t>, Strategy>>(traits, frame, parameters);
+            codec = make_default_codec<Strategy, uint16_t>(frame, parameters, preset_coding_parameters);
         }
     }
 
@@ -124,10 +199,34 @@ unique_ptr<Strategy> jls_codec_factory<Strategy>::create_optimized_codec(const f
     {
         if (parameters.interleave_mode == interleave_mode::sample)
         {
-            if (frame.component_count == 3 && frame.bits_per_sample == 8)
-                return make_codec<Strategy>(lossless_traits<triplet<uint8_t>, 8>(), frame, parameters);
-            if (frame.component_count == 4 && frame.bits_per_sample == 8)
-                return make_codec<Strategy>(lossless_traits<quad<uint8_t>, 8>(), frame, parameters);
+            if (frame.component_count == 3)
+            {
+                switch (frame.bits_per_sample)
+                {
+                case 8:
+                    return make_codec<Strategy>(lossless_traits<triplet<uint8_t>, 8>(), frame, parameters);
+                case 12:
+                    return make_codec<Strategy>(lossless_traits<triplet<uint16_t>, 12>(), frame, parameters);
+                case 16:
+                    return make_codec<Strategy>(lossless_traits<triplet<uint16_t>, 16>(), frame, parameters);
+                default:
+                    break;
+                }
+            }
+            else
+            {
+                switch (frame.bits_per_sample)
+                {
+                case 8:
+                    return make_codec<Strategy>(lossless_traits<quad<uint8_t>, 8>(), frame, parameters);
+                case 12:
+                    return make_codec<Strategy>(lossless_traits<quad<uint16_t>, 12>(), frame, parameters);
+                case 16:
+                    return make_codec<Strategy>(lossless_traits<quad<uint16_t>, 16>(), frame, parameters);
+                default:
+                    break;
+                }
+            }
         }
         else
         {
@@ -135,6 +234,8 @@ unique_ptr<Strategy> jls_codec_factory<Strategy>::create_optimized_codec(const f
             {
             case 8:
                 return make_codec<Strategy>(lossless_traits<uint8_t, 8>(), frame, parameters);
+            case 10:
+                return make_codec<Strategy>(lossless_traits<uint16_t, 10>(), frame, parameters);
             case 12:
                 return make_codec<Strategy>(lossless_traits<uint16_t, 12>(), frame, parameters);
             case 16:
@@ -144,6 +245,22 @@ unique_ptr<Strategy> jls_codec_factory<Strategy>::create_optimized_codec(const f
             }
         }
     }
+    else if (parameters.interleave_mode != interleave_mode::sample)
+    {
+        // optimized near-lossless versions for the common small NEAR values.
+        unique_ptr<Strategy> codec;
+        if (frame.bits_per_sample == 8)
+        {
+            codec = make_near_lossless_codec<Strategy, uint8_t, 8>(frame, parameters);
+        }
+        else if (frame.bits_per_sample == 16)
+        {
+            codec = make_near_lossless_codec<Strategy, uint16_t, 16>(frame, parameters);
+        }
+
+        if (codec)
+            return codec;
+    }
 
 #endif
 
@@ -177,6 +294,21 @@ unique_ptr<Strategy> jls_codec_factory<Strategy>::create_optimized_codec(const f
 }
 
 
+template<typename Strategy>
+size_t jls_codec_factory<Strategy>::maximum_codec_size() noexcept
+{
+    // The size of the traits doesn't depend on the bit count, the size of the sample type selects the largest instantiation.
+    return std::max(::maximum_codec_size<Strategy, uint8_t>(), ::maximum_codec_size<Strategy, uint16_t>());
+}
+
+template<typename Strategy>
+size_t jls_codec_factory<Strategy>::maximum_process_line_size() noexcept
+{
+    return std::max({sizeof(post_process_single_component), sizeof(post_process_single_stream),
+                     ::maximum_process_line_size<uint8_t>(), ::maximum_process_line_size<uint16_t>()});
+}
+
+
 template class jls_codec_factory<decoder_strategy>;
 template class jls_codec_factory<encoder_strategy>;
 
@@ -10,7 +10,7 @@
 
 namespace charls {
 
-// Optimized trait classes for lossless compression of 8 bit color and 8/16 bit monochrome images.
+// Optimized trait classes for lossless compression of 8/12/16 bit color and 8/10/12/16 bit monochrome images.
 // This class assumes MaximumSampleValue correspond to a whole number of bits, and no custom ResetValue is set when encoding.
 // The point of this is to have the most optimized code for the most common and most demanding scenario.
 template<typename SampleType, int32_t BitsPerPixel>
@@ -129,7 +129,10 @@ struct lossless_traits<triplet<PixelType>, BitsPerPixel> final : lossless_traits
 
     FORCE_INLINE static PixelType compute_reconstructed_sample(const int32_t predicted_value, const int32_t error_value) noexcept
     {
-        return static_cast<PixelType>(predicted_value + error_value);
+        if (BitsPerPixel == sizeof(PixelType) * 8)
+            return static_cast<PixelType>(predicted_value + error_value);
+
+        return static_cast<PixelType>(lossless_traits_impl<PixelType, BitsPerPixel>::maximum_sample_value & (predicted_value + error_value));
     }
 };
 
@@ -151,7 +154,10 @@ struct lossless_traits<quad<PixelType>, BitsPerPixel> final : lossless_traits_im
 
     FORCE_INLINE static PixelType compute_reconstructed_sample(const int32_t predicted_value, const int32_t error_value) noexcept
     {
-        return static_cast<PixelType>(predicted_value + error_value);
+        if (BitsPerPixel == sizeof(PixelType) * 8)
+            return static_cast<PixelType>(predicted_value + error_value);
+
+        return static_cast<PixelType>(lossless_traits_impl<PixelType, BitsPerPixel>::maximum_sample_value & (predicted_value + error_value));
     }
 };
 
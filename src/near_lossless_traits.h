@@ -0,0 +1,112 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "constants.h"
+#include "util.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace charls {
+
+// Single return statement version of log_2, as Visual Studio 2015 cannot evaluate loops at compile time.
+constexpr int32_t constexpr_log_2(const int32_t n, const int32_t x = 0) noexcept
+{
+    return n > (1 << x) ? constexpr_log_2(n, x + 1) : x;
+}
+
+
+// Optimized trait classes for near-lossless compression of 8/16 bit monochrome images with a small NEAR value.
+// NEAR is a compile time constant, which allows the compiler to replace the divisions by 2 * NEAR + 1 with a multiplication.
+// This class assumes MaximumSampleValue correspond to a whole number of bits, and no custom ResetValue is set when encoding.
+// The implementation is identical to default_traits, see default_traits.h for the description of the functions.
+template<typename SampleType, int32_t BitsPerPixel, int32_t NearLossless>
+struct near_lossless_traits final
+{
+    using sample_type = SampleType;
+    using pixel_type = SampleType;
+
+    static constexpr int32_t maximum_sample_value{(1 << BitsPerPixel) - 1};
+    static constexpr int32_t near_lossless{NearLossless};
+    static constexpr int32_t range{compute_range_parameter(maximum_sample_value, near_lossless)};
+    static constexpr int32_t quantized_bits_per_pixel{constexpr_log_2(range)};
+    static constexpr int32_t bits_per_pixel{BitsPerPixel};
+    static constexpr int32_t limit{compute_limit_parameter(BitsPerPixel)};
+    static constexpr int32_t reset_threshold{default_reset_value};
+
+    FORCE_INLINE static int32_t compute_error_value(const int32_t e) noexcept
+    {
+        return modulo_range(quantize(e));
+    }
+
+    FORCE_INLINE static SampleType compute_reconstructed_sample(const int32_t predicted_value, const int32_t error_value) noexcept
+    {
+        return fix_reconstructed_value(predicted_value + dequantize(error_value));
+    }
+
+    FORCE_INLINE static bool is_near(const int32_t lhs, const int32_t rhs) noexcept
+    {
+        return std::abs(lhs - rhs) <= near_lossless;
+    }
+
+    FORCE_INLINE static int32_t correct_prediction(const int32_t predicted) noexcept
+    {
+        if ((predicted & maximum_sample_value) == predicted)
+            return predicted;
+
+        return (~(predicted >> (int32_t_bit_count - 1))) & maximum_sample_value;
+    }
+
+    FORCE_INLINE static int32_t modulo_range(int32_t error_value) noexcept
+    {
+        ASSERT(std::abs(error_value) <= range);
+
+        if (error_value < 0)
+        {
+            error_value += range;
+        }
+
+        if (error_value >= (range + 1) / 2)
+        {
+            error_value -= range;
+        }
+
+        ASSERT(-range / 2 <= error_value && error_value <= ((range + 1) / 2) - 1);
+        return error_value;
+    }
+
+private:
+    static constexpr uint32_t quantization_step{2 * near_lossless + 1};
+
+    // The dividends are never negative: unsigned division by a constant only needs a multiplication and a shift.
+    FORCE_INLINE static int32_t quantize(const int32_t error_value) noexcept
+    {
+        if (error_value > 0)
+            return static_cast<int32_t>(static_cast<uint32_t>(error_value + near_lossless) / quantization_step);
+
+        return -static_cast<int32_t>(static_cast<uint32_t>(near_lossless - error_value) / quantization_step);
+    }
+
+    FORCE_INLINE static int32_t dequantize(const int32_t error_value) noexcept
+    {
+        return error_value * (2 * near_lossless + 1);
+    }
+
+    FORCE_INLINE static SampleType fix_reconstructed_value(int32_t value) noexcept
+    {
+        if (value < -near_lossless)
+        {
+            value = value + range * (2 * near_lossless + 1);
+        }
+        else if (value > maximum_sample_value + near_lossless)
+        {
+            value = value - range * (2 * near_lossless + 1);
+        }
+
+        return static_cast<SampleType>(correct_prediction(value));
+    }
+};
+
+} // namespace charls
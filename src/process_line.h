@@ -6,13 +6,13 @@
 #include <charls/charls_legacy.h>
 #include <charls/jpegls_error.h>
 
+#include "allocator.h"
 #include "coding_parameters.h"
 #include "util.h"
 
 #include <algorithm>
 #include <cstring>
 #include <sstream>
-#include <vector>
 
 
 //
@@ -26,7 +26,7 @@
 
 namespace charls {
 
-class process_line
+class process_line : public allocated_object
 {
 public:
     virtual ~process_line() = default;
@@ -39,6 +39,15 @@ class process_line
     virtual void new_line_decoded(const void* source, size_t pixel_count, int source_stride) = 0;
     virtual void new_line_requested(void* destination, size_t pixel_count, int destination_stride) = 0;
 
+    /// <summary>
+    /// Returns the next source line when it is already stored in the internal pixel format, or nullptr when it
+    /// needs to be converted with new_line_requested. A returned line is consumed and can be read in place by the encoder.
+    /// </summary>
+    virtual const void* source_line_in_place() noexcept
+    {
+        return nullptr;
+    }
+
 protected:
     process_line() = default;
 };
@@ -66,6 +75,17 @@ class post_process_single_component final : public process_line
         raw_data_ += bytes_per_line_;
     }
 
+    const void* source_line_in_place() noexcept override
+    {
+        // The lines can only be accessed in place when every line is correctly aligned for the pixel type.
+        if (reinterpret_cast<uintptr_t>(raw_data_) % bytes_per_pixel_ != 0 || bytes_per_line_ % bytes_per_pixel_ != 0)
+            return nullptr;
+
+        const uint8_t* line = raw_data_;
+        raw_data_ += bytes_per_line_;
+        return line;
+    }
+
 private:
     uint8_t* raw_data_;
     size_t bytes_per_pixel_;
@@ -363,8 +383,8 @@ class process_transformed final : public process_line
     const frame_info& frame_info_;
     const coding_parameters& parameters_;
     const uint32_t stride_;
-    std::vector<size_type> temp_line_;
-    std::vector<uint8_t> buffer_;
+    allocated_vector<size_type> temp_line_;
+    allocated_vector<uint8_t> buffer_;
     TransformType transform_;
     typename TransformType::inverse inverse_transform_;
     byte_stream_info raw_pixels_;
@@ -0,0 +1,94 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include "util.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHARLS_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace charls {
+
+#ifdef CHARLS_SSE2
+
+namespace impl {
+
+// 48 bytes is a multiple of the size of all pixel types (1, 2, 3, 4, 6 and 8 bytes) and of the SSE2 register size.
+constexpr size_t run_block_size{48};
+
+inline uint32_t count_trailing_one_bits(const uint64_t value) noexcept
+{
+    ASSERT(value != ~uint64_t{});
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, ~value);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(~value));
+#endif
+}
+
+} // namespace impl
+
+#endif
+
+
+/// <summary>
+/// Returns the number of pixels at the start of the pixel array that are identical to value (maximum pixel_count).
+/// Used to find the length of a run in lossless mode, 48 bytes are compared at a time when SSE2 is available.
+/// </summary>
+template<typename PixelType>
+int32_t count_equal_pixels(const PixelType* pixels, const PixelType value, const int32_t pixel_count) noexcept
+{
+    int32_t run_length{};
+
+#ifdef CHARLS_SSE2
+    static_assert(impl::run_block_size % sizeof(PixelType) == 0, "pixel size must divide the block size");
+    constexpr int32_t block_pixel_count{static_cast<int32_t>(impl::run_block_size / sizeof(PixelType))};
+    constexpr uint64_t all_equal{(uint64_t{1} << impl::run_block_size) - 1};
+
+    if (pixel_count >= block_pixel_count)
+    {
+        // The pixel types have no padding: a run of identical pixels is a repetition of the bytes of value.
+        alignas(16) uint8_t pattern[impl::run_block_size];
+        for (size_t i = 0; i < impl::run_block_size; i += sizeof(PixelType))
+        {
+            memcpy(pattern + i, &value, sizeof(PixelType));
+        }
+        const __m128i pattern0{_mm_load_si128(reinterpret_cast<const __m128i*>(pattern))};
+        const __m128i pattern1{_mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 16))};
+        const __m128i pattern2{_mm_load_si128(reinterpret_cast<const __m128i*>(pattern + 32))};
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>(pixels);
+        for (; run_length <= pixel_count - block_pixel_count; run_length += block_pixel_count, bytes += impl::run_block_size)
+        {
+            const auto mask0 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)), pattern0)));
+            const auto mask1 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16)), pattern1)));
+            const auto mask2 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 32)), pattern2)));
+            const uint64_t mask{mask0 | uint64_t{mask1} << 16 | uint64_t{mask2} << 32};
+            if (mask != all_equal)
+                return run_length + static_cast<int32_t>(impl::count_trailing_one_bits(mask) / sizeof(PixelType));
+        }
+    }
+#endif
+
+    while (run_length < pixel_count && pixels[run_length] == value)
+    {
+        ++run_length;
+    }
+
+    return run_length;
+}
+
+} // namespace charls
+
+#undef CHARLS_SSE2
@@ -9,9 +9,13 @@
 #include "context_run_mode.h"
 #include "lookup_table.h"
 #include "process_line.h"
+#include "run_length.h"
+#include "timing.h"
 
+#include <algorithm>
 #include <array>
 #include <sstream>
+#include <type_traits>
 
 // This file contains the code for handling a "scan". Usually an image is encoded as a single scan.
 // Note: the functions in this header could be moved into jpegls.cpp as they are only used in that file.
@@ -248,7 +252,13 @@ class jls_codec final : public Strategy
         const int32_t high_bits = Strategy::read_high_bits();
 
         if (high_bits >= limit - (quantized_bits_per_pixel + 1))
+        {
+            if (Strategy::statistics_)
+            {
+                ++Strategy::statistics_->escape_code_count;
+            }
             return Strategy::read_value(quantized_bits_per_pixel) + 1;
+        }
 
         if (k == 0)
             return high_bits;
@@ -284,6 +294,44 @@ class jls_codec final : public Strategy
         Strategy::append_to_bit_stream((mapped_error - 1) & ((1 << traits_.quantized_bits_per_pixel) - 1), traits_.quantized_bits_per_pixel);
     }
 
+    // Collecting statistics is a template parameter of the line functions, to keep the check out of the per sample path.
+    static void update_regular_mode_statistics(int32_t, const jls_context&, std::false_type) noexcept
+    {
+    }
+
+    void update_regular_mode_statistics(const int32_t k, const jls_context& context, std::true_type) const noexcept
+    {
+        ++Strategy::statistics_->regular_mode_sample_count;
+        ++Strategy::statistics_->golomb_parameter_count[k];
+        if (context.N == traits_.reset_threshold)
+        {
+            ++Strategy::statistics_->context_reset_count;
+        }
+    }
+
+    static void update_escape_code_statistics(int32_t, int32_t, int32_t, std::false_type) noexcept
+    {
+    }
+
+    // The encoder doesn't count escape codes in encode_mapped_value, as that would prevent it from being inlined.
+    void update_escape_code_statistics(const int32_t k, const int32_t mapped_error, const int32_t limit, std::true_type) const noexcept
+    {
+        if ((mapped_error >> k) >= limit - traits_.quantized_bits_per_pixel - 1)
+        {
+            ++Strategy::statistics_->escape_code_count;
+        }
+    }
+
+    void update_run_mode_statistics(const int32_t run_length, const bool interrupted) const noexcept
+    {
+        constexpr size_t component_count{sizeof(pixel_type) / sizeof(sample_type)};
+        Strategy::statistics_->run_mode_sample_count += static_cast<uint64_t>(run_length) * component_count;
+        if (interrupted)
+        {
+            ++Strategy::statistics_->run_interruption_count;
+        }
+    }
+
     void increment_run_index() noexcept
     {
         run_index_ = std::min(31, run_index_ + 1);
@@ -294,6 +342,7 @@ class jls_codec final : public Strategy
         run_index_ = std::max(0, run_index_ - 1);
     }
 
+    template<bool CollectStatistics>
     FORCE_INLINE sample_type do_regular(const int32_t qs, int32_t, const int32_t predicted, decoder_strategy*)
     {
         const int32_t sign = bit_wise_sign(qs);
@@ -319,11 +368,13 @@ class jls_codec final : public Strategy
         {
             error_value = error_value ^ context.get_error_correction(traits_.near_lossless);
         }
+        update_regular_mode_statistics(k, context, std::integral_constant<bool, CollectStatistics>{});
         context.update_variables(error_value, traits_.near_lossless, traits_.reset_threshold);
         error_value = apply_sign(error_value, sign);
         return traits_.compute_reconstructed_sample(predicted_value, error_value);
     }
 
+    template<bool CollectStatistics>
     FORCE_INLINE sample_type do_regular(const int32_t qs, int32_t x, const int32_t predicted, encoder_strategy*)
     {
         const int32_t sign = bit_wise_sign(qs);
@@ -332,13 +383,17 @@ class jls_codec final : public Strategy
         const int32_t predicted_value = traits_.correct_prediction(predicted + apply_sign(context.C, sign));
         const int32_t error_value = traits_.compute_error_value(apply_sign(x - predicted_value, sign));
 
-        encode_mapped_value(k, get_mapped_error_value(context.get_error_correction(k | traits_.near_lossless) ^ error_value), traits_.limit);
+        const int32_t mapped_error = get_mapped_error_value(context.get_error_correction(k | traits_.near_lossless) ^ error_value);
+        encode_mapped_value(k, mapped_error, traits_.limit);
+        update_regular_mode_statistics(k, context, std::integral_constant<bool, CollectStatistics>{});
+        update_escape_code_statistics(k, mapped_error, traits_.limit, std::integral_constant<bool, CollectStatistics>{});
         context.update_variables(error_value, traits_.near_lossless, traits_.reset_threshold);
         ASSERT(traits_.is_near(traits_.compute_reconstructed_sample(predicted_value, apply_sign(error_value, sign)), x));
         return static_cast<sample_type>(traits_.compute_reconstructed_sample(predicted_value, apply_sign(error_value, sign)));
     }
 
     /// <summary>Encodes/Decodes a scan line of samples</summary>
+    template<bool CollectStatistics>
     void do_line(sample_type*)
     {
         int32_t index = 0;
@@ -356,7 +411,7 @@ class jls_codec final : public Strategy
 
             if (qs != 0)
             {
-                current_line_[index] = do_regular(qs, current_line_[index], get_predicted_value(ra, rb, rc), static_cast<Strategy*>(nullptr));
+                current_line_[index] = do_regular<CollectStatistics>(qs, current_line_[index], get_predicted_value(ra, rb, rc), static_cast<Strategy*>(nullptr));
                 ++index;
             }
             else
@@ -369,6 +424,7 @@ class jls_codec final : public Strategy
     }
 
     /// <summary>Encodes/Decodes a scan line of triplets in ILV_SAMPLE mode</summary>
+    template<bool CollectStatistics>
     void do_line(triplet<sample_type>*)
     {
         int32_t index = 0;
@@ -390,9 +446,9 @@ class jls_codec final : public Strategy
             else
             {
                 triplet<sample_type> rx;
-                rx.v1 = do_regular(qs1, current_line_[index].v1, get_predicted_value(ra.v1, rb.v1, rc.v1), static_cast<Strategy*>(nullptr));
-                rx.v2 = do_regular(qs2, current_line_[index].v2, get_predicted_value(ra.v2, rb.v2, rc.v2), static_cast<Strategy*>(nullptr));
-                rx.v3 = do_regular(qs3, current_line_[index].v3, get_predicted_value(ra.v3, rb.v3, rc.v3), static_cast<Strategy*>(nullptr));
+                rx.v1 = do_regular<CollectStatistics>(qs1, current_line_[index].v1, get_predicted_value(ra.v1, rb.v1, rc.v1), static_cast<Strategy*>(nullptr));
+                rx.v2 = do_regular<CollectStatistics>(qs2, current_line_[index].v2, get_predicted_value(ra.v2, rb.v2, rc.v2), static_cast<Strategy*>(nullptr));
+                rx.v3 = do_regular<CollectStatistics>(qs3, current_line_[index].v3, get_predicted_value(ra.v3, rb.v3, rc.v3), static_cast<Strategy*>(nullptr));
                 current_line_[index] = rx;
                 ++index;
             }
@@ -412,10 +468,16 @@ class jls_codec final : public Strategy
     size_t encode_scan(std::unique_ptr<process_line> process_line, byte_stream_info& compressed_data)
     {
         Strategy::process_line_ = std::move(process_line);
+        reset_statistics();
 
+        const scoped_timer timer{Strategy::timing_, &timing_statistics::scan_nanoseconds};
         Strategy::initialize(compressed_data);
-        do_scan();
+        if (!try_do_scan_in_place(static_cast<pixel_type*>(nullptr))) // dummy argument for overload resolution
+        {
+            do_scan();
+        }
 
+        complete_statistics();
         return Strategy::get_length();
     }
 
@@ -424,12 +486,14 @@ class jls_codec final : public Strategy
     {
         Strategy::process_line_ = std::move(process_line);
 
-        const uint8_t* compressed_bytes = compressed_data.rawData;
         rect_ = rect;
+        reset_statistics();
 
+        const scoped_timer timer{Strategy::timing_, &timing_statistics::scan_nanoseconds};
         Strategy::initialize(compressed_data);
         do_scan();
-        skip_bytes(compressed_data, static_cast<size_t>(Strategy::get_cur_byte_pos() - compressed_bytes));
+        complete_statistics();
+        Strategy::skip_consumed_bytes(compressed_data);
     }
     MSVC_WARNING_UNSUPPRESS()
 
@@ -437,6 +501,22 @@ class jls_codec final : public Strategy
 #pragma clang diagnostic pop
 #endif
 
+    void reset_statistics() const noexcept
+    {
+        if (Strategy::statistics_)
+        {
+            *Strategy::statistics_ = {};
+        }
+    }
+
+    void complete_statistics() const noexcept
+    {
+        if (Strategy::statistics_)
+        {
+            Strategy::statistics_->stuffed_bit_count = Strategy::stuffed_bit_count();
+        }
+    }
+
     void initialize_parameters(const int32_t t1, const int32_t t2, const int32_t t3, const int32_t reset_threshold)
     {
         t1_ = t1;
@@ -467,16 +547,65 @@ class jls_codec final : public Strategy
     }
 
     // do_scan: Encodes or decodes a scan.
+    // Selects the concrete (final) process_line type that create_process_line has created for the common cases,
+    // which allows the compiler to inline the line copy/transform into the scan loop instead of making a virtual call per line.
+    void do_scan()
+    {
+        process_line& line_processor = *Strategy::process_line_;
+
+        if (!is_interleaved())
+        {
+            if (try_do_scan<post_process_single_component>(line_processor))
+                return;
+        }
+        else
+        {
+            switch (parameters().transformation)
+            {
+            case color_transformation::none:
+                if (try_do_scan<process_transformed<transform_none<sample_type>>>(line_processor))
+                    return;
+                break;
+            case color_transformation::hp1:
+                if (try_do_scan<process_transformed<transform_hp1<sample_type>>>(line_processor))
+                    return;
+                break;
+            case color_transformation::hp2:
+                if (try_do_scan<process_transformed<transform_hp2<sample_type>>>(line_processor))
+                    return;
+                break;
+            case color_transformation::hp3:
+                if (try_do_scan<process_transformed<transform_hp3<sample_type>>>(line_processor))
+                    return;
+                break;
+            }
+        }
+
+        do_scan(line_processor);
+    }
+
+    template<typename ProcessLine>
+    bool try_do_scan(process_line& line_processor)
+    {
+        auto* const concrete_line_processor = dynamic_cast<ProcessLine*>(&line_processor);
+        if (!concrete_line_processor)
+            return false;
+
+        do_scan(*concrete_line_processor);
+        return true;
+    }
+
     // In ILV_SAMPLE mode, multiple components are handled in do_line
     // In ILV_LINE mode, a call do do_line is made for every component
     // In ILV_NONE mode, do_scan is called for each component
-    void do_scan()
+    template<typename ProcessLine>
+    void do_scan(ProcessLine& line_processor)
     {
         const uint32_t pixel_stride = width_ + 4U;
         const size_t component_count = parameters().interleave_mode == interleave_mode::line ? static_cast<size_t>(frame_info().component_count) : 1U;
 
-        std::vector<pixel_type> vectmp(static_cast<size_t>(2) * component_count * pixel_stride);
-        std::vector<int32_t> run_index(component_count);
+        allocated_vector<pixel_type> vectmp(static_cast<size_t>(2) * component_count * pixel_stride);
+        allocated_vector<int32_t> run_index(component_count);
 
         for (uint32_t line = 0; line < frame_info().height; ++line)
         {
@@ -487,7 +616,10 @@ class jls_codec final : public Strategy
                 std::swap(previous_line_, current_line_);
             }
 
-            Strategy::on_line_begin(width_, current_line_, pixel_stride);
+            {
+                const scoped_timer timer{Strategy::timing_, &timing_statistics::process_line_nanoseconds};
+                Strategy::on_line_begin(line_processor, width_, current_line_, pixel_stride);
+            }
 
             for (auto component = 0U; component < component_count; ++component)
             {
@@ -496,7 +628,14 @@ class jls_codec final : public Strategy
                 // initialize edge pixels used for prediction
                 previous_line_[width_] = previous_line_[width_ - 1];
                 current_line_[-1] = previous_line_[0];
-                do_line(static_cast<pixel_type*>(nullptr)); // dummy argument for overload resolution
+                if (Strategy::statistics_)
+                {
+                    do_line<true>(static_cast<pixel_type*>(nullptr)); // dummy argument for overload resolution
+                }
+                else
+                {
+                    do_line<false>(static_cast<pixel_type*>(nullptr)); // dummy argument for overload resolution
+                }
 
                 run_index[component] = run_index_;
                 previous_line_ += pixel_stride;
@@ -505,14 +644,102 @@ class jls_codec final : public Strategy
 
             if (static_cast<uint32_t>(rect_.Y) <= line && line < static_cast<uint32_t>(rect_.Y + rect_.Height))
             {
-                Strategy::on_line_end(rect_.Width, current_line_ + rect_.X - (static_cast<size_t>(component_count) * pixel_stride), pixel_stride);
+                const scoped_timer timer{Strategy::timing_, &timing_statistics::process_line_nanoseconds};
+                Strategy::on_line_end(line_processor, rect_.Width, current_line_ + rect_.X - (static_cast<size_t>(component_count) * pixel_stride), pixel_stride);
             }
         }
 
         Strategy::end_scan();
     }
 
+    // try_do_scan_in_place: Encodes a scan by reading the samples directly from the source lines.
+    // This is only possible in lossless mode, as the reconstructed samples are then identical to the source samples
+    // and the scan line buffers are not needed to store them.
+    bool try_do_scan_in_place(sample_type*)
+    {
+        // The statistics are collected by the line functions that use the scan line buffers.
+        if (traits_.near_lossless != 0 || Strategy::statistics_)
+            return false;
+
+        const sample_type* current_line = source_line_in_place();
+        if (!current_line)
+            return false;
+
+        // The line above the first line and the sample left of the first column of the line above are zero.
+        const allocated_vector<sample_type> zero_line(width_);
+        const sample_type* previous_line = zero_line.data();
+        int32_t rc_start{};
+        run_index_ = 0;
+
+        for (uint32_t line = 0;;)
+        {
+            encode_line_in_place(previous_line, current_line, rc_start);
+            if (++line == frame_info().height)
+                break;
+
+            rc_start = previous_line[0];
+            previous_line = current_line;
+            current_line = source_line_in_place();
+            ASSERT(current_line);
+        }
+
+        Strategy::end_scan();
+        return true;
+    }
+
+    // The source lines are not copied, but getting them is the process line stage of the in-place path.
+    const sample_type* source_line_in_place() const
+    {
+        const scoped_timer timer{Strategy::timing_, &timing_statistics::process_line_nanoseconds};
+        return static_cast<const sample_type*>(Strategy::process_line_->source_line_in_place());
+    }
+
+    static bool try_do_scan_in_place(triplet<sample_type>*) noexcept
+    {
+        return false;
+    }
+
+    static bool try_do_scan_in_place(quad<sample_type>*) noexcept
+    {
+        return false;
+    }
+
+    /// <summary>Encodes a scan line of samples, reads the edge samples used for prediction from the lines directly</summary>
+    void encode_line_in_place(const sample_type* previous_line, const sample_type* current_line, const int32_t rc_start)
+    {
+        const int32_t last_index = static_cast<int32_t>(width_) - 1;
+        int32_t index = 0;
+        int32_t rb = rc_start;
+        int32_t rd = previous_line[index];
+
+        while (index <= last_index)
+        {
+            const int32_t ra = index == 0 ? previous_line[0] : current_line[index - 1];
+            const int32_t rc = rb;
+            rb = rd;
+            rd = index == last_index ? rb : previous_line[index + 1];
+
+            const int32_t qs = compute_context_id(quantize_gradient(rd - rb), quantize_gradient(rb - rc), quantize_gradient(rc - ra));
+
+            if (qs != 0)
+            {
+                do_regular<false>(qs, current_line[index], get_predicted_value(ra, rb, rc), static_cast<Strategy*>(nullptr));
+                ++index;
+            }
+            else
+            {
+                index += encode_run_mode_in_place(index, previous_line, current_line);
+                if (index <= last_index)
+                {
+                    rb = previous_line[index - 1];
+                    rd = previous_line[index];
+                }
+            }
+        }
+    }
+
     /// <summary>Encodes/Decodes a scan line of quads in ILV_SAMPLE mode</summary>
+    template<bool CollectStatistics>
     void do_line(quad<sample_type>*)
     {
         int32_t index = 0;
@@ -535,10 +762,10 @@ class jls_codec final : public Strategy
             else
             {
                 quad<sample_type> rx;
-                rx.v1 = do_regular(qs1, current_line_[index].v1, get_predicted_value(ra.v1, rb.v1, rc.v1), static_cast<Strategy*>(nullptr));
-                rx.v2 = do_regular(qs2, current_line_[index].v2, get_predicted_value(ra.v2, rb.v2, rc.v2), static_cast<Strategy*>(nullptr));
-                rx.v3 = do_regular(qs3, current_line_[index].v3, get_predicted_value(ra.v3, rb.v3, rc.v3), static_cast<Strategy*>(nullptr));
-                rx.v4 = do_regular(qs4, current_line_[index].v4, get_predicted_value(ra.v4, rb.v4, rc.v4), static_cast<Strategy*>(nullptr));
+                rx.v1 = do_regular<CollectStatistics>(qs1, current_line_[index].v1, get_predicted_value(ra.v1, rb.v1, rc.v1), static_cast<Strategy*>(nullptr));
+                rx.v2 = do_regular<CollectStatistics>(qs2, current_line_[index].v2, get_predicted_value(ra.v2, rb.v2, rc.v2), static_cast<Strategy*>(nullptr));
+                rx.v3 = do_regular<CollectStatistics>(qs3, current_line_[index].v3, get_predicted_value(ra.v3, rb.v3, rc.v3), static_cast<Strategy*>(nullptr));
+                rx.v4 = do_regular<CollectStatistics>(qs4, current_line_[index].v4, get_predicted_value(ra.v4, rb.v4, rc.v4), static_cast<Strategy*>(nullptr));
                 current_line_[index] = rx;
                 ++index;
             }
@@ -593,19 +820,35 @@ class jls_codec final : public Strategy
     int32_t decode_run_pixels(pixel_type ra, pixel_type* start_pos, const int32_t pixel_count)
     {
         int32_t index = 0;
-        while (Strategy::read_bit())
+        for (;;)
         {
-            const int count = std::min(1 << J[run_index_], static_cast<int>(pixel_count - index));
-            index += count;
-            ASSERT(index <= pixel_count);
-
-            if (count == (1 << J[run_index_]))
+            // Process all run continuation (1) bits that are available in the read cache at once.
+            const int32_t continuation_bit_count = Strategy::peek_1_bits();
+            int32_t bit_count = 0;
+            while (bit_count < continuation_bit_count && index != pixel_count)
             {
-                increment_run_index();
+                const int count = std::min(1 << J[run_index_], pixel_count - index);
+                index += count;
+                ASSERT(index <= pixel_count);
+
+                if (count == (1 << J[run_index_]))
+                {
+                    increment_run_index();
+                }
+
+                ++bit_count;
             }
+            Strategy::skip(bit_count);
 
             if (index == pixel_count)
                 break;
+
+            if (bit_count < 16)
+            {
+                // Consume the 0 bit that ends the run, read_bit also detects a truncated stream.
+                Strategy::read_bit();
+                break;
+            }
         }
 
         if (index != pixel_count)
@@ -617,11 +860,7 @@ class jls_codec final : public Strategy
         if (index > pixel_count)
             impl::throw_jpegls_error(jpegls_errc::invalid_encoded_data);
 
-        for (int32_t i = 0; i < index; ++i)
-        {
-            start_pos[i] = ra;
-        }
-
+        std::fill(start_pos, start_pos + index, ra);
         return index;
     }
 
@@ -631,6 +870,10 @@ class jls_codec final : public Strategy
 
         const int32_t run_length = decode_run_pixels(ra, current_line_ + start_index, width_ - start_index);
         const uint32_t end_index = start_index + run_length;
+        if (Strategy::statistics_)
+        {
+            update_run_mode_statistics(run_length, end_index != width_);
+        }
 
         if (end_index == width_)
             return end_index - start_index;
@@ -650,6 +893,10 @@ class jls_codec final : public Strategy
 
         ASSERT(error_value == context.compute_error_value(e_mapped_error_value + context.run_interruption_type, k));
         encode_mapped_value(k, e_mapped_error_value, traits_.limit - J[run_index_] - 1);
+        if (Strategy::statistics_)
+        {
+            update_escape_code_statistics(k, e_mapped_error_value, traits_.limit - J[run_index_] - 1, std::true_type{});
+        }
         context.update_variables(error_value, e_mapped_error_value);
     }
 
@@ -734,16 +981,28 @@ class jls_codec final : public Strategy
         const pixel_type ra = type_cur_x[-1];
 
         int32_t run_length{};
-        while (traits_.is_near(type_cur_x[run_length], ra))
+        if (traits_.near_lossless == 0)
+        {
+            // In lossless mode the samples of the run are already equal to ra.
+            run_length = count_equal_pixels(type_cur_x, ra, ctypeRem);
+        }
+        else
         {
-            type_cur_x[run_length] = ra;
-            ++run_length;
+            while (traits_.is_near(type_cur_x[run_length], ra))
+            {
+                type_cur_x[run_length] = ra;
+                ++run_length;
 
-            if (run_length == ctypeRem)
-                break;
+                if (run_length == ctypeRem)
+                    break;
+            }
         }
 
         encode_run_pixels(run_length, run_length == ctypeRem);
+        if (Strategy::statistics_)
+        {
+            update_run_mode_statistics(run_length, run_length != ctypeRem);
+        }
 
         if (run_length == ctypeRem)
             return run_length;
@@ -753,6 +1012,24 @@ class jls_codec final : public Strategy
         return run_length + 1;
     }
 
+    int32_t encode_run_mode_in_place(const int32_t index, const sample_type* previous_line, const sample_type* current_line)
+    {
+        const int32_t ctypeRem = width_ - index;
+        const sample_type* type_cur_x = current_line + index;
+        const int32_t ra = index == 0 ? previous_line[0] : type_cur_x[-1];
+
+        const int32_t run_length{count_equal_pixels(type_cur_x, static_cast<sample_type>(ra), ctypeRem)};
+
+        encode_run_pixels(run_length, run_length == ctypeRem);
+
+        if (run_length == ctypeRem)
+            return run_length;
+
+        encode_run_interruption_pixel(type_cur_x[run_length], ra, previous_line[index + run_length]);
+        decrement_run_index();
+        return run_length + 1;
+    }
+
     // codec parameters
     Traits traits_;
     JlsRect rect_{};
@@ -770,7 +1047,7 @@ class jls_codec final : public Strategy
 
     // quantization lookup table
     int8_t* quantization_{};
-    std::vector<int8_t> quantization_lut_;
+    allocated_vector<int8_t> quantization_lut_;
 };
 
 
@@ -0,0 +1,63 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <charls/public_types.h>
+
+#ifdef CHARLS_TIMING
+#include <chrono>
+#endif
+
+namespace charls {
+
+#ifdef CHARLS_TIMING
+
+// Adds the wall time between construction and destruction to a counter of the timing statistics.
+// Nothing is measured when no timing statistics are passed (codecs created by the legacy API).
+class scoped_timer final
+{
+public:
+    scoped_timer(timing_statistics* timing, uint64_t timing_statistics::*counter) noexcept :
+        timing_{timing}, counter_{counter}
+    {
+        if (timing_)
+        {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~scoped_timer()
+    {
+        if (timing_)
+        {
+            timing_->*counter_ += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+        }
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer(scoped_timer&&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+    scoped_timer& operator=(scoped_timer&&) = delete;
+
+private:
+    timing_statistics* timing_;
+    uint64_t timing_statistics::*counter_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+// Empty implementation, the compiler removes all usages when the timing instrumentation is not enabled.
+class scoped_timer final
+{
+public:
+    constexpr scoped_timer(timing_statistics* /*timing*/, uint64_t timing_statistics::* /*counter*/) noexcept
+    {
+    }
+};
+
+#endif
+
+} // namespace charls
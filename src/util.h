@@ -12,6 +12,10 @@
 #include <cstring>
 #include <vector>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 // Use an uppercase alias for assert to make it clear that ASSERT is a pre-processor macro.
 #ifdef _MSC_VER
 #define ASSERT(expression)                 \
@@ -124,14 +128,16 @@ inline jpegls_errc set_error_message(const jpegls_errc error, OUT_WRITES_Z_(Erro
 constexpr size_t int32_t_bit_count = sizeof(int32_t) * 8;
 
 
-inline void push_back(std::vector<uint8_t>& values, const uint16_t value)
+template<typename Allocator>
+void push_back(std::vector<uint8_t, Allocator>& values, const uint16_t value)
 {
     values.push_back(static_cast<uint8_t>(value >> 8));
     values.push_back(static_cast<uint8_t>(value));
 }
 
 
-inline void push_back(std::vector<uint8_t>& values, const uint32_t value)
+template<typename Allocator>
+void push_back(std::vector<uint8_t, Allocator>& values, const uint32_t value)
 {
     values.push_back(static_cast<uint8_t>(value >> 24));
     values.push_back(static_cast<uint8_t>(value >> 16));
@@ -163,6 +169,58 @@ constexpr int32_t bit_wise_sign(const int32_t i) noexcept
 }
 
 
+/// <summary>
+/// Returns the number of leading 0 bits of a 32 or 64 bit unsigned value. The value may not be zero.
+/// Compiles to a single instruction (lzcnt, bsr or clz) on the supported compilers.
+/// </summary>
+template<typename T>
+FORCE_INLINE int32_t count_leading_zeros(const T value) noexcept
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "only 32 and 64 bit values are supported");
+    ASSERT(value != 0);
+
+#if defined(__GNUC__) || defined(__clang__)
+    if (sizeof(T) == 8)
+        return __builtin_clzll(static_cast<unsigned long long>(value));
+
+    return __builtin_clz(static_cast<unsigned int>(value));
+#elif defined(_MSC_VER)
+    unsigned long index;
+#if defined(_M_X64) || defined(_M_ARM64)
+    if (sizeof(T) == 8)
+    {
+        _BitScanReverse64(&index, static_cast<unsigned long long>(value));
+        return 63 - static_cast<int32_t>(index);
+    }
+#else
+    if (sizeof(T) == 8)
+    {
+        // 32 bit targets have no _BitScanReverse64: scan the high half, or the low half when the high half is 0.
+        const unsigned long high{static_cast<unsigned long>(static_cast<uint64_t>(value) >> 32)};
+        if (high != 0)
+        {
+            _BitScanReverse(&index, high);
+            return 31 - static_cast<int32_t>(index);
+        }
+
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return 63 - static_cast<int32_t>(index);
+    }
+#endif
+
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return 31 - static_cast<int32_t>(index);
+#else
+    int32_t count{};
+    for (T mask = T{1} << (sizeof(T) * 8 - 1); (value & mask) == 0; mask >>= 1)
+    {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+
 /// <summary>
 /// Computes the parameter RANGE. When NEAR = 0, RANGE = MAXVAL + 1. (see ISO/IEC 14495-1, A.2.1)
 /// </summary>
@@ -216,13 +274,15 @@ struct triplet
 };
 
 
-inline bool operator==(const triplet<uint8_t>& lhs, const triplet<uint8_t>& rhs) noexcept
+template<typename SampleType>
+bool operator==(const triplet<SampleType>& lhs, const triplet<SampleType>& rhs) noexcept
 {
     return lhs.v1 == rhs.v1 && lhs.v2 == rhs.v2 && lhs.v3 == rhs.v3;
 }
 
 
-inline bool operator!=(const triplet<uint8_t>& lhs, const triplet<uint8_t>& rhs) noexcept
+template<typename SampleType>
+bool operator!=(const triplet<SampleType>& lhs, const triplet<SampleType>& rhs) noexcept
 {
     return !(lhs == rhs);
 }
@@ -255,6 +315,20 @@ struct quad final : triplet<SampleType>
 };
 
 
+template<typename SampleType>
+bool operator==(const quad<SampleType>& lhs, const quad<SampleType>& rhs) noexcept
+{
+    return lhs.v1 == rhs.v1 && lhs.v2 == rhs.v2 && lhs.v3 == rhs.v3 && lhs.v4 == rhs.v4;
+}
+
+
+template<typename SampleType>
+bool operator!=(const quad<SampleType>& lhs, const quad<SampleType>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+
 template<int Size>
 struct from_big_endian final
 {
@@ -295,6 +369,53 @@ inline void skip_bytes(byte_stream_info& stream_info, const std::size_t count) n
 }
 
 
+// Position in a source that consists of multiple buffer segments (scatter-gather). The byte_stream_info that is used
+// together with the cursor holds the remaining bytes of the current segment (index).
+struct segment_cursor final
+{
+    const buffer_segment* segments;
+    std::size_t count;
+    std::size_t index;
+
+    // Moves to the next non-empty segment, returns false (and keeps the position) at the end of the source.
+    bool next(byte_stream_info& stream_info) noexcept
+    {
+        for (std::size_t i = index + 1; i < count; ++i)
+        {
+            if (segments[i].size != 0)
+            {
+                index = i;
+                stream_info = from_byte_array_const(segments[i].data, segments[i].size);
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+
+// Destination that consists of a chain of buffers, the next buffer is requested from the caller when the current one is full.
+struct destination_chain final
+{
+    destination_buffer_handler handler;
+    void* user_context;
+    byte_stream_info buffer;         // the current buffer
+    std::size_t previous_bytes;      // total size of the (full) buffers before the current buffer
+
+    void next()
+    {
+        std::size_t size{};
+        void* data{handler(user_context, &size)};
+        if (!data || size == 0)
+            impl::throw_jpegls_error(jpegls_errc::destination_buffer_too_small);
+
+        previous_bytes += buffer.count;
+        buffer = from_byte_array(data, size);
+    }
+};
+
+
 template<typename T>
 std::ostream& operator<<(typename std::enable_if<std::is_enum<T>::value, std::ostream>::type& stream, const T& e)
 {
@@ -7,14 +7,18 @@
 
 #include "util.h"
 
+#include "../samples/common/memory_mapped_file.h"
+
 #include "bitstreamdamage.h"
 #include "compliance.h"
 #include "dicomsamples.h"
 #include "legacy.h"
 #include "performance.h"
+#include "throughput_report.h"
 
 #include <algorithm>
 #include <array>
+#include <cstdlib>
 #include <fstream>
 #include <random>
 #include <sstream>
@@ -30,9 +34,7 @@ using std::getline;
 using std::ios;
 using std::ios_base;
 using std::istream;
-using std::iter_swap;
 using std::mt19937;
-using std::ostream;
 using std::streamoff;
 using std::string;
 using std::stringstream;
@@ -43,7 +45,6 @@ using namespace charls;
 namespace {
 
 constexpr ios::openmode mode_input = ios::in | ios::binary;
-constexpr ios::openmode mode_output = ios::out | ios::binary;
 
 
 vector<uint8_t> scan_file(const char* name_encoded, JlsParameters* params)
@@ -422,41 +423,73 @@ void test_encode_from_stream(const char* file, const int offset, const int width
 }
 
 
-bool decode_to_pnm(istream& input, ostream& output)
+// Decodes a JPEG-LS file into the PNM format. The encoded file is mapped into memory and the
+// pixels are decoded directly into the mapped output file, after the PNM header.
+// The output file is removed when the decoding fails.
+bool decode_to_pnm(const char* name_encoded, const char* name_output)
 {
-    const byte_stream_info input_info{input.rdbuf(), nullptr, 0};
+    try
+    {
+        const memory_mapped_file encoded_file{name_encoded};
+        jpegls_decoder decoder{encoded_file};
+        decoder.read_header();
 
-    auto params = JlsParameters();
-    error_code error = JpegLsReadHeaderStream(input_info, &params);
-    if (error)
-        return false;
+        const frame_info frame{decoder.frame_info()};
+        if (frame.component_count != 1 && frame.component_count != 3)
+        {
+            cout << "Only images with 1 or 3 components can be stored in the PNM format\n";
+            return false;
+        }
 
-    input.seekg(0);
+        const int max_value = (1 << frame.bits_per_sample) - 1;
+        const int magic_number = frame.component_count == 3 ? 6 : 5;
+        stringstream header;
+        header << 'P' << magic_number << "\n"
+               << frame.width << ' ' << frame.height << "\n"
+               << max_value << "\n";
+        const string header_text{header.str()};
 
-    const int max_value = (1 << params.bitsPerSample) - 1;
-    const int bytes_per_sample = max_value > 255 ? 2 : 1;
-    vector<uint8_t> output_buffer(static_cast<size_t>(params.width) * params.height * bytes_per_sample * params.components);
-    const auto output_info = from_byte_array(output_buffer.data(), output_buffer.size());
-    error = JpegLsDecodeStream(output_info, input_info, &params);
-    if (error)
-        return false;
+        const size_t pixel_data_size{decoder.destination_size()};
+        memory_mapped_file pnm_file{name_output, header_text.size() + pixel_data_size};
+        memcpy(pnm_file.data(), header_text.data(), header_text.size());
+        uint8_t* pixel_data{pnm_file.data() + header_text.size()};
 
-    // PNM format requires most significant byte first (big endian).
-    if (bytes_per_sample == 2)
-    {
-        for (auto i = output_buffer.begin(); i != output_buffer.end(); i += 2)
+        if (frame.component_count == 3 && decoder.interleave_mode() == interleave_mode::none)
         {
-            iter_swap(i, i + 1);
+            // The decoder returns the color planes one after the other, PNM stores the components of a pixel together.
+            const auto planar{decoder.decode<vector<uint8_t>>()};
+            const size_t sample_size{max_value > 255 ? 2U : 1U};
+            const size_t plane_size{pixel_data_size / 3};
+            for (size_t source{}, target{}; source != plane_size; source += sample_size, target += 3 * sample_size)
+            {
+                for (size_t component{}; component != 3; ++component)
+                {
+                    memcpy(&pixel_data[target + component * sample_size], &planar[component * plane_size + source], sample_size);
+                }
+            }
+        }
+        else
+        {
+            decoder.decode(pixel_data, pixel_data_size);
         }
-    }
 
-    const int magic_number = params.components == 3 ? 6 : 5;
-    output << 'P' << magic_number << "\n"
-           << params.width << ' ' << params.height << "\n"
-           << max_value << "\n";
-    output.write(reinterpret_cast<char*>(output_buffer.data()), output_buffer.size());
+        // PNM format requires most significant byte first (big endian).
+        if (max_value > 255)
+        {
+            for (size_t i{}; i != pixel_data_size; i += 2)
+            {
+                std::swap(pixel_data[i], pixel_data[i + 1]);
+            }
+        }
 
-    return true;
+        pnm_file.close(pnm_file.size());
+        return true;
+    }
+    catch (const std::exception& error)
+    {
+        cout << error.what() << "\n";
+        return false;
+    }
 }
 
 
@@ -473,7 +506,8 @@ vector<int> read_pnm_header(istream& pnm_file)
     while (read_values.size() < 4)
     {
         string bytes;
-        getline(pnm_file, bytes);
+        if (!getline(pnm_file, bytes))
+            break;
         stringstream line(bytes);
 
         while (read_values.size() < 4)
@@ -490,44 +524,80 @@ vector<int> read_pnm_header(istream& pnm_file)
 }
 
 
+// Read-only stream buffer over a block of memory. Used to parse the header of a mapped file with the stream functions,
+// without copying the file.
+class memory_stream_buffer final : public std::streambuf
+{
+public:
+    memory_stream_buffer(const uint8_t* data, const size_t size)
+    {
+        // The get area is never written: the stream buffer only reads.
+        char* begin{const_cast<char*>(reinterpret_cast<const char*>(data))};
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(const off_type offset, const std::ios_base::seekdir direction, const std::ios_base::openmode /*mode*/) override
+    {
+        if (offset != 0 || direction != std::ios_base::cur)
+            return pos_type(off_type(-1));
+
+        return pos_type(gptr() - eback());
+    }
+};
+
+
 // Purpose: this function can encode an image stored in the Portable Anymap Format (PNM)
 //          into the JPEG-LS format. The 2 binary formats P5 and P6 are supported:
 //          Portable GrayMap: P5 = binary, extension = .pgm, 0-2^16 (gray scale)
 //          Portable PixMap: P6 = binary, extension.ppm, range 0-2^16 (RGB)
-bool encode_pnm(istream& pnm_file, const ostream& jls_file_stream)
+//          Both files are mapped into memory: the pixels are encoded in place and the encoded bytes
+//          are written directly into the output file. The output file is removed when the encoding fails.
+bool encode_pnm(const char* name_pnm, const char* name_encoded)
 {
-    vector<int> read_values = read_pnm_header(pnm_file);
-    if (read_values.size() != 4)
-        return false;
-
-    JlsParameters params{};
-    params.components = read_values[0] == 6 ? 3 : 1;
-    params.width = read_values[1];
-    params.height = read_values[2];
-    params.bitsPerSample = log_2(read_values[3] + 1);
-    params.interleaveMode = params.components == 3 ? interleave_mode::line : interleave_mode::none;
-
-    const int bytes_per_sample = ::bit_to_byte_count(params.bitsPerSample);
-    vector<uint8_t> input_buffer(static_cast<size_t>(params.width) * params.height * bytes_per_sample * params.components);
-    pnm_file.read(reinterpret_cast<char*>(input_buffer.data()), input_buffer.size());
-    if (!pnm_file.good())
-        return false;
-
-    // PNM format is stored with most significant byte first (big endian).
-    if (bytes_per_sample == 2)
+    try
     {
-        for (auto i = input_buffer.begin(); i != input_buffer.end(); i += 2)
+        // Copy-on-write: 16 bit pixels are converted to little endian in place, without modifying the file.
+        memory_mapped_file pnm_file{name_pnm, memory_mapped_file::access::copy_on_write};
+
+        memory_stream_buffer header_buffer{pnm_file.data(), pnm_file.size()};
+        istream header{&header_buffer};
+        vector<int> read_values = read_pnm_header(header);
+        if (read_values.size() != 4 || (read_values[0] != 5 && read_values[0] != 6) || read_values[3] > 65535)
+            return false;
+
+        const auto header_size{static_cast<size_t>(header.tellg())};
+        const frame_info frame{static_cast<uint32_t>(read_values[1]), static_cast<uint32_t>(read_values[2]),
+                               log_2(read_values[3] + 1), read_values[0] == 6 ? 3 : 1};
+        const int bytes_per_sample = ::bit_to_byte_count(frame.bits_per_sample);
+        const size_t pixel_data_size{static_cast<size_t>(frame.width) * frame.height * bytes_per_sample * frame.component_count};
+        if (header.fail() || pnm_file.size() - header_size < pixel_data_size)
+            return false;
+
+        uint8_t* pixel_data{pnm_file.data() + header_size};
+
+        // PNM format is stored with most significant byte first (big endian).
+        if (bytes_per_sample == 2)
         {
-            iter_swap(i, i + 1);
+            for (size_t i{}; i != pixel_data_size; i += 2)
+            {
+                std::swap(pixel_data[i], pixel_data[i + 1]);
+            }
         }
-    }
 
-    const auto raw_stream_info = from_byte_array(input_buffer.data(), input_buffer.size());
-    const byte_stream_info jls_stream_info = {jls_file_stream.rdbuf(), nullptr, 0};
+        jpegls_encoder encoder;
+        encoder.frame_info(frame).interleave_mode(frame.component_count == 3 ? interleave_mode::line : interleave_mode::none);
 
-    size_t bytes_written{};
-    JpegLsEncodeStream(jls_stream_info, bytes_written, raw_stream_info, params);
-    return true;
+        memory_mapped_file encoded_file{name_encoded, encoder.estimated_destination_size()};
+        encoder.destination(encoded_file.data(), encoded_file.size());
+        encoded_file.close(encoder.encode(pixel_data, pixel_data_size));
+        return true;
+    }
+    catch (const std::exception& error)
+    {
+        cout << error.what() << "\n";
+        return false;
+    }
 }
 
 
@@ -634,19 +704,51 @@ bool compare_pnm(istream& pnm_file1, istream& pnm_file2)
 ////}
 
 
-jpegls_errc decode_raw(const char* name_encoded, const char* name_output)
+// Decodes a JPEG-LS file from a memory mapped file directly into a mapped output file.
+// The output file is removed when the decoding fails.
+bool decode_raw(const char* name_encoded, const char* name_output)
 {
-    fstream jls_file(name_encoded, mode_input);
-    const byte_stream_info compressed_byte_stream{jls_file.rdbuf(), nullptr, 0};
+    try
+    {
+        const memory_mapped_file encoded_file{name_encoded};
+        jpegls_decoder decoder{encoded_file};
+        decoder.read_header();
+
+        memory_mapped_file raw_file{name_output, decoder.destination_size()};
+        decoder.decode(raw_file.data(), raw_file.size());
+        raw_file.close(raw_file.size());
+        return true;
+    }
+    catch (const std::exception& error)
+    {
+        cout << error.what() << "\n";
+        return false;
+    }
+}
+
+
+void test_decode_from_stream(const stream_read_options& options)
+{
+    const vector<uint8_t> encoded{read_file("test/lena8b.jls")};
+    vector<uint8_t> expected;
+    jpegls_decoder::decode(encoded, expected);
+
+    basic_filebuf<char> jls_file;
+    jls_file.open("test/lena8b.jls", mode_input);
+    assert::is_true(jls_file.is_open());
 
-    fstream raw_file(name_output, mode_output);
-    const byte_stream_info raw_stream{raw_file.rdbuf(), nullptr, 0};
+    vector<uint8_t> decoded(expected.size());
+    const auto error = JpegLsDecodeStream(from_byte_array(decoded.data(), decoded.size()), {&jls_file, nullptr, 0}, nullptr, options);
+    assert::is_true(error == jpegls_errc::success);
+    assert::is_true(decoded == expected);
+}
 
-    const auto value = JpegLsDecodeStream(raw_stream, compressed_byte_stream, nullptr);
-    jls_file.close();
-    raw_file.close();
 
-    return value;
+void test_decode_from_stream()
+{
+    test_decode_from_stream({});
+    test_decode_from_stream({1500, false});
+    test_decode_from_stream({4096, true});
 }
 
 
@@ -661,6 +763,68 @@ void test_encode_from_stream()
 }
 
 
+struct allocation_counters
+{
+    size_t allocations;
+    size_t frees;
+};
+
+void* CHARLS_API_CALLING_CONVENTION counting_allocate(void* user_context, const size_t size)
+{
+    ++static_cast<allocation_counters*>(user_context)->allocations;
+    return malloc(size); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void CHARLS_API_CALLING_CONVENTION counting_free(void* user_context, void* pointer)
+{
+    ++static_cast<allocation_counters*>(user_context)->frees;
+    free(pointer); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void test_custom_allocator()
+{
+    assert::is_true(charls_set_allocator(counting_allocate, nullptr, nullptr) == jpegls_errc::invalid_argument);
+
+    const vector<uint8_t> encoded{read_file("test/conformance/T8C0E0.JLS")};
+    allocation_counters counters{};
+    set_allocator(counting_allocate, counting_free, &counters);
+
+    vector<uint8_t> decoded;
+    const auto frame_info{jpegls_decoder::decode(encoded, decoded).first};
+    const vector<uint8_t> reencoded{jpegls_encoder::encode(decoded, frame_info)};
+
+    set_allocator(nullptr, nullptr);
+    assert::is_true(reencoded == encoded);
+    assert::is_true(counters.allocations != 0);
+    assert::is_true(counters.allocations == counters.frees);
+}
+
+void test_decode_with_workspace()
+{
+    const vector<uint8_t> encoded{read_file("test/conformance/T8C1E3.JLS")};
+    vector<uint8_t> expected;
+    jpegls_decoder::decode(encoded, expected);
+
+    allocation_counters counters{};
+    set_allocator(counting_allocate, counting_free, &counters);
+    {
+        const probe_info info{jpegls_decoder::probe(encoded)};
+        vector<uint8_t> workspace(jpegls_decoder::workspace_size(info.frame_info, info.interleave_mode));
+
+        jpegls_decoder decoder{encoded};
+        decoder.read_header();
+        decoder.workspace(workspace.data(), workspace.size());
+        vector<uint8_t> decoded(decoder.destination_size());
+
+        const size_t allocations{counters.allocations};
+        decoder.decode(decoded);
+        assert::is_true(counters.allocations == allocations);
+        assert::is_true(decoded == expected);
+    }
+    set_allocator(nullptr, nullptr);
+}
+
+
 void unit_test()
 {
     try
@@ -669,6 +833,7 @@ void unit_test()
 
         cout << "Test Conformance\n";
         test_encode_from_stream();
+        test_decode_from_stream();
         test_conformance();
 
         test_decode_rect();
@@ -700,6 +865,10 @@ void unit_test()
         test_decode_bit_stream_with_unsupported_encoding();
         test_decode_bit_stream_with_unknown_jpeg_marker();
 
+        cout << "Test custom allocator\n";
+        test_custom_allocator();
+        test_decode_with_workspace();
+
         cout << "Test Legacy API\n";
         test_legacy_api();
     }
@@ -716,13 +885,43 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
 {
     if (argc == 1)
     {
-        cout << "CharLS test runner.\nOptions: -unittest, -bitstreamdamage, -performance[:loop-count], -decodeperformance[:loop-count], -decoderaw -encodepnm -decodetopnm -comparepnm -legacy\n";
+        cout << "CharLS test runner.\nOptions: -unittest, -bitstreamdamage, -performance[:loop-count], -decodeperformance[:loop-count], -syntheticperformance[:loop-count[:widthxheight]], -report:file[.json|.csv], -baseline:file.csv, -threshold:percent, -decoderaw -encodepnm -decodetopnm -comparepnm -legacy\n";
         return EXIT_FAILURE;
     }
 
+    // The throughput measured by the performance tests can be written to a report and compared against a baseline report.
+    string report_filename;
+    string baseline_filename;
+    double threshold_percent{5};
+
     for (int i = 1; i < argc; ++i)
     {
         string str = argv[i];
+        if (str.compare(0, 8, "-report:") == 0)
+        {
+            report_filename = str.substr(8);
+            continue;
+        }
+
+        if (str.compare(0, 10, "-baseline:") == 0)
+        {
+            baseline_filename = str.substr(10);
+            continue;
+        }
+
+        if (str.compare(0, 11, "-threshold:") == 0)
+        {
+            const string value = str.substr(11);
+            char* end{};
+            threshold_percent = std::strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0' || threshold_percent < 0)
+            {
+                cout << "Threshold not understood or invalid: " << str << "\n";
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
         if (str == "-unittest")
         {
             unit_test();
@@ -736,7 +935,7 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
                 cout << "Syntax: -decoderaw inputfile outputfile\n";
                 return EXIT_FAILURE;
             }
-            return make_error_code(decode_raw(argv[2], argv[3])) ? EXIT_FAILURE : EXIT_SUCCESS;
+            return decode_raw(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
 
         if (str == "-decodetopnm")
@@ -746,10 +945,7 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
                 cout << "Syntax: -decodetopnm inputfile outputfile\n";
                 return EXIT_FAILURE;
             }
-            fstream pnm_file(argv[3], mode_output);
-            fstream jls_file(argv[2], mode_input);
-
-            return decode_to_pnm(jls_file, pnm_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+            return decode_to_pnm(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
 
         if (str == "-encodepnm")
@@ -759,10 +955,7 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
                 cout << "Syntax: -encodepnm inputfile outputfile\n";
                 return EXIT_FAILURE;
             }
-            fstream pnm_file(argv[2], mode_input);
-            const fstream jls_file(argv[3], mode_output);
-
-            return encode_pnm(pnm_file, jls_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+            return encode_pnm(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
         }
 
         if (str == "-comparepnm")
@@ -811,6 +1004,39 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
             continue;
         }
 
+        if (str.compare(0, 21, "-syntheticperformance") == 0)
+        {
+            int loop_count{1};
+            rect_size size{1024, 1024};
+
+            // Extract the optional loop count and image size from the command line. Sizes up to 16384x16384 are practical.
+            auto index = str.find(':');
+            if (index != string::npos)
+            {
+                const auto size_index = str.find(':', index + 1);
+                loop_count = stoi(str.substr(index + 1, size_index == string::npos ? string::npos : size_index - index - 1));
+                if (size_index != string::npos)
+                {
+                    const auto separator_index = str.find('x', size_index);
+                    if (separator_index == string::npos)
+                    {
+                        cout << "Image size not understood: " << str << "\n";
+                        break;
+                    }
+                    size = rect_size(stoul(str.substr(size_index + 1, separator_index - size_index - 1)), stoul(str.substr(separator_index + 1)));
+                }
+
+                if (loop_count < 1 || size.cx == 0 || size.cy == 0)
+                {
+                    cout << "Loop count or image size not understood or invalid: " << str << "\n";
+                    break;
+                }
+            }
+
+            synthetic_performance_tests(loop_count, size);
+            continue;
+        }
+
         if (str.compare(0, 18, "-decodeperformance") == 0)
         {
             int loop_count{1};
@@ -847,5 +1073,13 @@ int main(const int argc, const char* const argv[]) // NOLINT(bugprone-exception-
         break;
     }
 
+    if (!report_filename.empty())
+    {
+        write_throughput_report(report_filename);
+    }
+
+    if (!baseline_filename.empty())
+        return compare_throughput_with_baseline(baseline_filename, threshold_percent) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
@@ -1,28 +1,36 @@
 // Copyright (c) Team CharLS.
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include "performance.h"
 #include "util.h"
 
+#include "performance.h"
+#include "synthetic_image.h"
+#include "throughput_report.h"
+
 #include <chrono>
 #include <iostream>
 #include <ratio>
+#include <string>
 #include <vector>
 
+using charls::interleave_mode;
 using charls::jpegls_decoder;
 using charls::jpegls_error;
 using std::cout;
 using std::istream;
 using std::milli;
+using std::string;
+using std::to_string;
 using std::vector;
 using std::chrono::duration;
 using std::chrono::steady_clock;
 
 namespace {
 
-void test_file16_bit_as12(const char* filename, const int offset, const rect_size size2, const int component_count, const bool little_endian_file)
+void test_file16_bit_as(const char* filename, const int offset, const rect_size size2, const int bits_per_sample, const int component_count,
+                        const bool little_endian_file, const int loop_count = 1, const interleave_mode interleave_mode = interleave_mode::none)
 {
-    vector<uint8_t> uncompressed_data = read_file(filename, offset);
+    vector<uint8_t> uncompressed_data = read_file(filename, offset, size2.cx * size2.cy * component_count * 2);
 
     fix_endian(&uncompressed_data, little_endian_file);
 
@@ -30,10 +38,17 @@ void test_file16_bit_as12(const char* filename, const int offset, const rect_siz
 
     for (size_t i = 0; i < uncompressed_data.size() / 2; ++i)
     {
-        p[i] = p[i] >> 4;
+        p[i] = static_cast<uint16_t>(p[i] >> (16 - bits_per_sample));
     }
 
-    test_round_trip(filename, uncompressed_data, size2, 12, component_count);
+    JlsParameters params{};
+    params.width = static_cast<int>(size2.cx);
+    params.height = static_cast<int>(size2.cy);
+    params.bitsPerSample = bits_per_sample;
+    params.components = component_count;
+    params.interleaveMode = interleave_mode;
+
+    test_round_trip(filename, uncompressed_data, params, loop_count);
 }
 
 
@@ -50,6 +65,9 @@ void test_performance(const int loop_count)
     // 16 bit mono
     test_file("test/MR2_UNC", 1728, size1024, 16, 1, true, loop_count);
 
+    // 10 bit mono
+    test_file16_bit_as("test/MR2_UNC", 1728, size1024, 10, 1, true, loop_count);
+
     // 8 bit mono
     test_file("test/0015.raw", 0, size1024, 8, 1, false, loop_count);
     test_file("test/lena8b.raw", 0, size512, 8, 1, false, loop_count);
@@ -59,13 +77,38 @@ void test_performance(const int loop_count)
 
     // 12 bit RGB
     test_file("test/SIEMENS-MR-RGB-16Bits.dcm", -1, rect_size(192, 256), 12, 3, true, loop_count);
-    test_file16_bit_as12("test/DSC_5455.raw", 142949, rect_size(300, 200), 3, true);
+    test_file16_bit_as("test/DSC_5455.raw", 142949, rect_size(300, 200), 12, 3, true);
+    test_file16_bit_as("test/DSC_5455.raw", 142949, rect_size(300, 200), 12, 3, true, loop_count, interleave_mode::sample);
 
     // 16 bit RGB
     test_file("test/DSC_5455.raw", 142949, rect_size(300, 200), 16, 3, true, loop_count);
+    test_file16_bit_as("test/DSC_5455.raw", 142949, rect_size(300, 200), 16, 3, true, loop_count, interleave_mode::sample);
 }
 
 
+void test_synthetic_image(const synthetic_pattern pattern, const char* pattern_name, const rect_size size, const int bits_per_sample,
+                          const int component_count, const int noise_bits, const int loop_count,
+                          const interleave_mode interleave_mode = interleave_mode::none)
+{
+    const auto width = static_cast<uint32_t>(size.cx);
+    const auto height = static_cast<uint32_t>(size.cy);
+
+    // The name contains all generator arguments, which makes it usable as key for comparisons with a baseline report.
+    const string name = string("synthetic/") + pattern_name + "-" + to_string(noise_bits) + "/" + to_string(width) + "x" +
+                        to_string(height) + "/" + to_string(bits_per_sample) + "-bit";
+
+    const vector<uint8_t> image = create_synthetic_image(pattern, width, height, bits_per_sample, component_count, noise_bits);
+
+    JlsParameters params{};
+    params.width = static_cast<int>(width);
+    params.height = static_cast<int>(height);
+    params.bitsPerSample = bits_per_sample;
+    params.components = component_count;
+    params.interleaveMode = interleave_mode;
+
+    test_round_trip(name.c_str(), image, params, loop_count);
+}
+
 } // namespace
 
 
@@ -108,9 +151,35 @@ void test_large_image_performance_rgb8(const int loop_count)
     catch (const istream::failure& error)
     {
         cout << "Test failed " << error.what() << "\n";
+        cout << "Use -syntheticperformance to measure the performance with generated images\n";
     }
 }
 
+void synthetic_performance_tests(const int loop_count, const rect_size size)
+{
+#ifdef _DEBUG
+    cout << "NOTE: running performance test in debug mode, performance may be slow!\n";
+#endif
+    cout << "Test Synthetic Images Performance (" << size.cx << "x" << size.cy << ", with loop count " << loop_count << ")\n";
+
+    // 8 bit mono, from highly compressible to incompressible.
+    test_synthetic_image(synthetic_pattern::gradient, "gradient", size, 8, 1, 0, loop_count);
+    test_synthetic_image(synthetic_pattern::noise, "noise", size, 8, 1, 2, loop_count);
+    test_synthetic_image(synthetic_pattern::noise, "noise", size, 8, 1, 4, loop_count);
+    test_synthetic_image(synthetic_pattern::noise, "noise", size, 8, 1, 8, loop_count);
+    test_synthetic_image(synthetic_pattern::flat_regions, "flat_regions", size, 8, 1, 4, loop_count);
+
+    // 8 bit color
+    test_synthetic_image(synthetic_pattern::noise, "noise", size, 8, 3, 4, loop_count);
+    test_synthetic_image(synthetic_pattern::noise, "noise", size, 8, 3, 4, loop_count, interleave_mode::sample);
+    test_synthetic_image(synthetic_pattern::flat_regions, "flat_regions", size, 8, 3, 4, loop_count, interleave_mode::sample);
+
+    // 12 and 16 bit mono, medical images
+    test_synthetic_image(synthetic_pattern::medical_texture, "medical_texture", size, 12, 1, 5, loop_count);
+    test_synthetic_image(synthetic_pattern::medical_texture, "medical_texture", size, 16, 1, 8, loop_count);
+    test_synthetic_image(synthetic_pattern::gradient, "gradient", size, 16, 1, 0, loop_count);
+}
+
 void decode_performance_tests(const int loop_count)
 {
     cout << "Test decode Perf (with loop count " << loop_count << ")\n";
@@ -121,6 +190,9 @@ void decode_performance_tests(const int loop_count)
     {
         vector<uint8_t> uncompressed;
 
+        jpegls_decoder decoder;
+        decoder.source(jpegls_compressed).read_header();
+
         const auto start = steady_clock::now();
         for (int i = 0; i < loop_count; ++i)
         {
@@ -131,6 +203,12 @@ void decode_performance_tests(const int loop_count)
         const auto diff = end - start;
         cout << "Total decoding time is: " << duration<double, milli>(diff).count() << " ms\n";
         cout << "Decoding time per image: " << duration<double, milli>(diff).count() / loop_count << " ms\n";
+
+        const auto uncompressed_size = static_cast<double>(uncompressed.size());
+        record_throughput({"decodetest.jls", decoder.frame_info().bits_per_sample, decoder.frame_info().component_count,
+                           decoder.interleave_mode(), decoder.near_lossless(), 0,
+                           megabytes_per_second(uncompressed_size * loop_count, duration<double, milli>(diff).count()),
+                           uncompressed_size / static_cast<double>(jpegls_compressed.size()), peak_resident_set_size()});
     }
     catch (const jpegls_error& e)
     {
@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include "util.h"
+
 void performance_tests(int loop_count);
 void decode_performance_tests(int loop_count);
 void test_large_image_performance_rgb8(int loop_count);
+void synthetic_performance_tests(int loop_count, rect_size size);
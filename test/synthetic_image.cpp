@@ -0,0 +1,161 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "synthetic_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+using std::mt19937;
+using std::vector;
+
+namespace {
+
+constexpr uint32_t block_size{64};
+
+
+// Uniform noise in the range [-2^(noise_bits - 1), 2^(noise_bits - 1)).
+// The raw generator output is used as std::uniform_int_distribution is implementation defined.
+int32_t uniform_noise(mt19937& generator, const int32_t noise_bits)
+{
+    if (noise_bits == 0)
+        return 0;
+
+    const auto mask = (1U << noise_bits) - 1U;
+    return static_cast<int32_t>(generator() & mask) - static_cast<int32_t>((mask + 1) / 2);
+}
+
+
+// Integer hash to assign a pseudo random value to a block, independent of the order in which the blocks are visited.
+uint32_t hash(uint32_t x, const uint32_t y, const uint32_t seed) noexcept
+{
+    x = x * 0x9E3779B1U ^ (y + 0x7F4A7C15U) * 0x85EBCA77U ^ seed * 0xC2B2AE3DU;
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+    return x;
+}
+
+
+int32_t gradient_value(const uint32_t x, const uint32_t y, const uint32_t width, const uint32_t height, const int32_t component,
+                       const int32_t maximum_value) noexcept
+{
+    const auto horizontal = static_cast<int32_t>(uint64_t{x} * static_cast<uint64_t>(maximum_value) / std::max(width - 1, 1U));
+    const auto vertical = static_cast<int32_t>(uint64_t{y} * static_cast<uint64_t>(maximum_value) / std::max(height - 1, 1U));
+
+    // Use a different direction for every component, to prevent that the color transformations remove all information.
+    switch (component % 4)
+    {
+    case 0:
+        return (horizontal + vertical) / 2;
+    case 1:
+        return maximum_value - (horizontal + vertical) / 2;
+    case 2:
+        return horizontal;
+    default:
+        return vertical;
+    }
+}
+
+
+int32_t flat_regions_value(const uint32_t x, const uint32_t y, const int32_t component, const int32_t maximum_value,
+                           const int32_t noise_bits, const uint32_t seed, mt19937& generator)
+{
+    const uint32_t block_hash = hash(x / block_size, y / block_size, seed + static_cast<uint32_t>(component));
+    const int32_t value = static_cast<int32_t>(block_hash >> 8) & maximum_value;
+
+    // One in four blocks is noisy to create run interruptions at realistic positions.
+    if ((block_hash & 3) == 0)
+        return value + uniform_noise(generator, std::max(noise_bits, 1));
+
+    return value;
+}
+
+
+int32_t medical_texture_value(const uint32_t x, const uint32_t y, const uint32_t width, const uint32_t height,
+                              const int32_t maximum_value, const int32_t noise_bits, mt19937& generator)
+{
+    const int64_t radius = std::min(width, height) * 7 / 16;
+    const int64_t radius_squared = radius * radius;
+    const int64_t dx = int64_t{x} - width / 2;
+    const int64_t dy = int64_t{y} - height / 2;
+    const int64_t distance_squared = dx * dx + dy * dy;
+    if (distance_squared > radius_squared || radius_squared == 0)
+        return 0; // Air around the object is coded in run mode.
+
+    // Soft tissue that becomes brighter towards the center.
+    int64_t value = maximum_value * int64_t{3} / 8 + maximum_value / 4 * (radius_squared - distance_squared) / radius_squared;
+
+    // A denser structure (bone like) with sharp edges, off center.
+    const int64_t structure_dx = dx + radius / 3;
+    const int64_t structure_dy = dy - radius / 4;
+    if (structure_dx * structure_dx + structure_dy * structure_dy < radius_squared / 16)
+    {
+        value += maximum_value / 4;
+    }
+
+    // Grain with a triangular distribution, like the sum of independent noise sources.
+    value += (uniform_noise(generator, noise_bits) + uniform_noise(generator, noise_bits)) / 2;
+    return static_cast<int32_t>(value);
+}
+
+} // namespace
+
+
+vector<uint8_t> create_synthetic_image(const synthetic_pattern pattern, const uint32_t width, const uint32_t height,
+                                       const int32_t bits_per_sample, const int32_t component_count, const int32_t noise_bits,
+                                       const uint32_t seed)
+{
+    const int32_t maximum_value = (1 << bits_per_sample) - 1;
+    const size_t bytes_per_sample = bits_per_sample > 8 ? 2 : 1;
+    vector<uint8_t> image(static_cast<size_t>(width) * height * static_cast<size_t>(component_count) * bytes_per_sample);
+
+    mt19937 generator(seed);
+    uint8_t* destination = image.data();
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            for (int32_t component = 0; component < component_count; ++component)
+            {
+                int32_t value;
+                switch (pattern)
+                {
+                case synthetic_pattern::gradient:
+                    value = gradient_value(x, y, width, height, component, maximum_value);
+                    break;
+
+                case synthetic_pattern::noise:
+                    value = gradient_value(x, y, width, height, component, maximum_value) + uniform_noise(generator, noise_bits);
+                    break;
+
+                case synthetic_pattern::flat_regions:
+                    value = flat_regions_value(x, y, component, maximum_value, noise_bits, seed, generator);
+                    break;
+
+                default:
+                    value = medical_texture_value(x, y, width, height, maximum_value, noise_bits, generator);
+                    break;
+                }
+
+                value = std::min(std::max(value, 0), maximum_value);
+                if (bytes_per_sample == 1)
+                {
+                    *destination = static_cast<uint8_t>(value);
+                }
+                else
+                {
+                    const auto sample = static_cast<uint16_t>(value);
+                    memcpy(destination, &sample, sizeof sample);
+                }
+                destination += bytes_per_sample;
+            }
+        }
+    }
+
+    return image;
+}
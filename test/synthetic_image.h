@@ -0,0 +1,30 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class synthetic_pattern
+{
+    // Smooth diagonal gradient, well predicted by the regular mode.
+    gradient,
+
+    // Gradient with uniform noise, the noise level (in bits) controls the entropy.
+    noise,
+
+    // Blocks of constant value with noisy blocks in between, exercises the run mode.
+    flat_regions,
+
+    // Smooth round object with a grainy texture on a zero background, similar to CT/MR images.
+    medical_texture
+};
+
+/// <summary>
+/// Creates an image filled with a synthetic pattern. Only integer arithmetic and the raw output of std::mt19937 are used, which
+/// makes the image identical on all platforms and compilers for the same arguments.
+/// Samples are stored in native byte order, components are sample interleaved.
+/// </summary>
+std::vector<uint8_t> create_synthetic_image(synthetic_pattern pattern, uint32_t width, uint32_t height, int32_t bits_per_sample,
+                                            int32_t component_count, int32_t noise_bits = 0, uint32_t seed = 42);
@@ -0,0 +1,310 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "throughput_report.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using charls::interleave_mode;
+using std::cout;
+using std::getline;
+using std::ifstream;
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace {
+
+vector<throughput_measurement> measurements;
+
+
+const char* to_string(const interleave_mode interleave_mode) noexcept
+{
+    switch (interleave_mode)
+    {
+    case interleave_mode::none:
+        return "none";
+    case interleave_mode::line:
+        return "line";
+    case interleave_mode::sample:
+        return "sample";
+    }
+
+    return "unknown";
+}
+
+
+interleave_mode to_interleave_mode(const string& text)
+{
+    if (text == "line")
+        return interleave_mode::line;
+
+    if (text == "sample")
+        return interleave_mode::sample;
+
+    return interleave_mode::none;
+}
+
+
+bool has_same_configuration(const throughput_measurement& lhs, const throughput_measurement& rhs) noexcept
+{
+    return lhs.image == rhs.image && lhs.bits_per_sample == rhs.bits_per_sample && lhs.component_count == rhs.component_count &&
+           lhs.interleave_mode == rhs.interleave_mode && lhs.near_lossless == rhs.near_lossless;
+}
+
+
+string escape_json(const string& text)
+{
+    string result;
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result.push_back('\\');
+        }
+        result.push_back(c);
+    }
+
+    return result;
+}
+
+
+void write_json(ostream& output)
+{
+    output << "[\n";
+    for (size_t i = 0; i < measurements.size(); ++i)
+    {
+        const auto& measurement = measurements[i];
+        output << "  {\"image\": \"" << escape_json(measurement.image) << "\", \"bits_per_sample\": " << measurement.bits_per_sample
+               << ", \"component_count\": " << measurement.component_count << ", \"interleave_mode\": \"" << to_string(measurement.interleave_mode)
+               << "\", \"near_lossless\": " << measurement.near_lossless << ", \"encode_mb_per_s\": " << measurement.encode_megabytes_per_second
+               << ", \"decode_mb_per_s\": " << measurement.decode_megabytes_per_second << ", \"compression_ratio\": " << measurement.compression_ratio
+               << ", \"peak_rss_bytes\": " << measurement.peak_resident_set_size << "}" << (i + 1 < measurements.size() ? ",\n" : "\n");
+    }
+    output << "]\n";
+}
+
+
+// Note: image names with a comma are not supported, as fields are not quoted.
+void write_csv(ostream& output)
+{
+    output << "image,bits_per_sample,component_count,interleave_mode,near_lossless,encode_mb_per_s,decode_mb_per_s,compression_ratio,peak_rss_bytes\n";
+    for (const auto& measurement : measurements)
+    {
+        output << measurement.image << ',' << measurement.bits_per_sample << ',' << measurement.component_count << ','
+               << to_string(measurement.interleave_mode) << ',' << measurement.near_lossless << ',' << measurement.encode_megabytes_per_second
+               << ',' << measurement.decode_megabytes_per_second << ',' << measurement.compression_ratio << ','
+               << measurement.peak_resident_set_size << "\n";
+    }
+}
+
+
+vector<throughput_measurement> read_csv(ifstream& input)
+{
+    vector<throughput_measurement> result;
+
+    string line;
+    getline(input, line); // skip the header.
+    while (getline(input, line))
+    {
+        if (line.empty())
+            continue;
+
+        vector<string> fields;
+        stringstream line_stream(line);
+        string field;
+        while (getline(line_stream, field, ','))
+        {
+            fields.push_back(field);
+        }
+
+        if (fields.size() != 9)
+        {
+            cout << "Baseline line not understood: " << line << "\n";
+            continue;
+        }
+
+        try
+        {
+            result.push_back({fields[0], std::stoi(fields[1]), std::stoi(fields[2]), to_interleave_mode(fields[3]), std::stoi(fields[4]),
+                              std::stod(fields[5]), std::stod(fields[6]), std::stod(fields[7]),
+                              static_cast<size_t>(std::stoull(fields[8]))});
+        }
+        catch (const std::logic_error&)
+        {
+            // std::stoi and friends throw std::invalid_argument or std::out_of_range for malformed numbers.
+            cout << "Baseline line not understood: " << line << "\n";
+        }
+    }
+
+    return result;
+}
+
+
+// Returns true when the current rate is more than threshold_percent slower than the baseline rate.
+bool check_rate(const throughput_measurement& measurement, const char* operation, const double rate, const double baseline_rate,
+                const double threshold_percent)
+{
+    if (rate <= 0 || baseline_rate <= 0)
+    {
+        if (rate > 0 || baseline_rate > 0)
+        {
+            cout << "WARNING    " << measurement.image << " " << operation << ": not measured in "
+                 << (rate > 0 ? "the baseline" : "this run") << "\n";
+        }
+        return false;
+    }
+
+    const double change_percent = (rate - baseline_rate) * 100 / baseline_rate;
+    const bool regression = change_percent < -threshold_percent;
+
+    cout << (regression ? "REGRESSION " : "OK         ") << measurement.image << " (" << measurement.bits_per_sample << " bit, "
+         << measurement.component_count << " components, interleave " << to_string(measurement.interleave_mode) << ", near "
+         << measurement.near_lossless << ") " << operation << ": " << std::fixed << std::setprecision(1) << rate << " MB/s, baseline "
+         << baseline_rate << " MB/s (" << std::showpos << change_percent << std::noshowpos << "%)\n"
+         << std::defaultfloat;
+
+    return regression;
+}
+
+} // namespace
+
+
+size_t peak_resident_set_size() noexcept
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+        return 0;
+
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // macOS reports bytes.
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // Linux reports kilobytes.
+#endif
+#endif
+}
+
+
+double megabytes_per_second(const double byte_count, const double milliseconds) noexcept
+{
+    return milliseconds > 0 ? byte_count / (1000.0 * milliseconds) : 0;
+}
+
+
+void record_throughput(throughput_measurement measurement)
+{
+    measurements.push_back(std::move(measurement));
+}
+
+
+void write_throughput_report(const string& filename)
+{
+    ofstream output(filename);
+    if (!output)
+    {
+        cout << "Failed to create report file: " << filename << "\n";
+        return;
+    }
+
+    output << std::setprecision(6);
+
+    constexpr size_t json_extension_length{5};
+    if (filename.size() >= json_extension_length && filename.compare(filename.size() - json_extension_length, json_extension_length, ".json") == 0)
+    {
+        write_json(output);
+    }
+    else
+    {
+        write_csv(output);
+    }
+}
+
+
+int compare_throughput_with_baseline(const string& baseline_filename, const double threshold_percent)
+{
+    ifstream input(baseline_filename);
+    if (!input)
+    {
+        cout << "Failed to open baseline file: " << baseline_filename << "\n";
+        return 1;
+    }
+
+    const vector<throughput_measurement> baseline = read_csv(input);
+    if (baseline.empty())
+    {
+        cout << "Baseline file contains no measurements: " << baseline_filename << "\n";
+        return 1;
+    }
+
+    if (measurements.empty())
+    {
+        cout << "No measurements to compare with the baseline, run a performance test together with -baseline\n";
+        return 1;
+    }
+
+    cout << "Compare with baseline " << baseline_filename << " (threshold " << threshold_percent << "%)\n";
+    int regression_count{};
+    for (const auto& measurement : measurements)
+    {
+        const auto it = std::find_if(baseline.cbegin(), baseline.cend(),
+                                     [&measurement](const throughput_measurement& other) { return has_same_configuration(measurement, other); });
+        if (it == baseline.cend())
+        {
+            cout << "MISSING    No baseline for " << measurement.image << " (" << measurement.bits_per_sample << " bit, "
+                 << measurement.component_count << " components, interleave " << to_string(measurement.interleave_mode) << ", near "
+                 << measurement.near_lossless << ")\n";
+            ++regression_count;
+            continue;
+        }
+
+        if (check_rate(measurement, "encode", measurement.encode_megabytes_per_second, it->encode_megabytes_per_second, threshold_percent))
+        {
+            ++regression_count;
+        }
+
+        if (check_rate(measurement, "decode", measurement.decode_megabytes_per_second, it->decode_megabytes_per_second, threshold_percent))
+        {
+            ++regression_count;
+        }
+    }
+
+    for (const auto& entry : baseline)
+    {
+        if (std::none_of(measurements.cbegin(), measurements.cend(),
+                         [&entry](const throughput_measurement& other) { return has_same_configuration(entry, other); }))
+        {
+            cout << "WARNING    Baseline entry not measured in this run: " << entry.image << "\n";
+        }
+    }
+
+    cout << (regression_count == 0 ? "No regressions detected\n" : "==> Throughput regressions detected <==\n");
+    return regression_count;
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <charls/charls.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct throughput_measurement final
+{
+    std::string image;
+    int32_t bits_per_sample;
+    int32_t component_count;
+    charls::interleave_mode interleave_mode;
+    int32_t near_lossless;
+    double encode_megabytes_per_second; // 0 when only decoding is measured.
+    double decode_megabytes_per_second;
+    double compression_ratio;
+    size_t peak_resident_set_size; // Peak memory usage of the process in bytes, 0 when not available.
+};
+
+/// <summary>
+/// Returns the peak resident set size (peak working set on Windows) of the current process in bytes.
+/// </summary>
+size_t peak_resident_set_size() noexcept;
+
+/// <summary>
+/// Returns the throughput in MB/s, or 0 when the duration is too short to be measured.
+/// </summary>
+double megabytes_per_second(double byte_count, double milliseconds) noexcept;
+
+void record_throughput(throughput_measurement measurement);
+
+/// <summary>
+/// Writes all recorded measurements to a JSON file when the filename ends with .json, otherwise to a CSV file.
+/// </summary>
+void write_throughput_report(const std::string& filename);
+
+/// <summary>
+/// Compares the recorded measurements with a baseline CSV file written by a previous run.
+/// Reports every encode or decode rate that is more than threshold_percent slower than the baseline.
+/// Measurements without a baseline entry count as a failure, baseline entries that were not measured are reported as warning.
+/// </summary>
+/// <returns>The number of detected regressions and missing baseline entries, 1 when there is nothing to compare.</returns>
+int compare_throughput_with_baseline(const std::string& baseline_filename, double threshold_percent);
@@ -4,6 +4,7 @@
 #include "util.h"
 
 #include "portable_anymap_file.h"
+#include "throughput_report.h"
 
 #include <chrono>
 #include <iomanip>
@@ -61,13 +62,13 @@ vector<uint8_t> read_file(const char* filename, long offset, size_t bytes)
 
     input.seekg(0, ios::end);
     const auto byte_count_file = static_cast<int>(input.tellg());
-    input.seekg(offset, ios::beg);
 
     if (offset < 0)
     {
         assert::is_true(bytes != 0);
         offset = static_cast<long>(byte_count_file - bytes);
     }
+    input.seekg(offset, ios::beg);
     if (bytes == 0)
     {
         bytes = static_cast<size_t>(byte_count_file) - offset;
@@ -94,21 +95,26 @@ void test_round_trip(const char* name, const vector<uint8_t>& decoded_buffer, co
 
 void test_round_trip(const char* name, const vector<uint8_t>& original_buffer, const JlsParameters& params, const int loop_count)
 {
-    vector<uint8_t> encoded_buffer(params.height * params.width * params.components * params.bitsPerSample / 4);
+    vector<uint8_t> encoded_buffer(static_cast<size_t>(params.height) * params.width * params.components * params.bitsPerSample / 4);
 
     vector<uint8_t> decoded_buffer(static_cast<size_t>(params.height) * params.width * bit_to_byte_count(params.bitsPerSample) * params.components);
 
     interleave_mode interleave_mode{params.interleaveMode};
     color_transformation color_transformation{params.colorTransformation};
 
-    if (params.components == 4)
+    if (params.components == 4 && interleave_mode == interleave_mode::none)
     {
         interleave_mode = interleave_mode::line;
     }
-    else if (params.components == 3)
+    else if (params.components == 3 && interleave_mode == interleave_mode::none)
     {
         interleave_mode = interleave_mode::line;
-        color_transformation = color_transformation::hp1;
+
+        // The color transformations are only supported for 8 and 16 bit samples.
+        if (params.bitsPerSample == 8 || params.bitsPerSample == 16)
+        {
+            color_transformation = color_transformation::hp1;
+        }
     }
 
     size_t encoded_actual_size{};
@@ -121,6 +127,7 @@ void test_round_trip(const char* name, const vector<uint8_t>& original_buffer, c
             encoder.destination(encoded_buffer)
                 .frame_info({static_cast<uint32_t>(params.width), static_cast<uint32_t>(params.height), params.bitsPerSample, params.components})
                 .interleave_mode(interleave_mode)
+                .near_lossless(params.allowedLossyError)
                 .color_transformation(color_transformation);
 
             encoded_actual_size = encoder.encode(original_buffer);
@@ -158,6 +165,11 @@ void test_round_trip(const char* name, const vector<uint8_t>& original_buffer, c
 
     cout << "Size:" << setw(10) << params.width << "x" << params.height << setw(7) << setprecision(2) << ", Encode time:" << encode_time << " ms, Decode time:" << decode_time << " ms, Bits per sample:" << bits_per_sample << ", Decode rate:" << symbol_rate << " M/s\n";
 
+    const auto uncompressed_size = static_cast<double>(original_buffer.size());
+    record_throughput({name, params.bitsPerSample, params.components, interleave_mode, params.allowedLossyError,
+                       megabytes_per_second(uncompressed_size, encode_time), megabytes_per_second(uncompressed_size, decode_time),
+                       uncompressed_size / static_cast<double>(encoded_actual_size), peak_resident_set_size()});
+
     const uint8_t* byte_out = decoded_buffer.data();
     for (size_t i = 0; i < decoded_buffer.size(); ++i)
     {
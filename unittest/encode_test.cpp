@@ -51,6 +51,87 @@ TEST_CLASS(encode_test)
         encode("DataFiles/TEST8.PPM", interleave_mode::sample);
     }
 
+    TEST_METHOD(encode_8_bit_with_reset_value) // NOLINT
+    {
+        // A non default reset value selects the generic codec. It needs the triplet and quad pixel types in sample
+        // interleave mode and the default maximum sample value when the preset value is 0.
+        constexpr uint32_t width{64};
+        constexpr uint32_t height{32};
+        for (const int32_t component_count : {1, 3, 4})
+        {
+            const vector<uint8_t> source{create_noise_image_8_bit(static_cast<size_t>(width) * height * static_cast<size_t>(component_count), 4, 1)};
+
+            jpegls_encoder encoder;
+            encoder.frame_info({width, height, 8, component_count})
+                .interleave_mode(component_count == 1 ? interleave_mode::none : interleave_mode::sample)
+                .preset_coding_parameters({0, 0, 0, 0, 32});
+
+            vector<uint8_t> encoded(encoder.estimated_destination_size());
+            encoder.destination(encoded);
+            encoded.resize(encoder.encode(source));
+
+            vector<uint8_t> destination;
+            jpegls_decoder::decode(encoded, destination);
+
+            Assert::IsTrue(source == destination);
+        }
+    }
+
+    TEST_METHOD(encode_monochrome_16_bit_from_unaligned_buffer) // NOLINT
+    {
+        const portable_anymap_file reference_file = read_anymap_reference_file("DataFiles/16-bit-640-480-many-dots.pgm", interleave_mode::none);
+        const vector<uint8_t>& image_data = reference_file.image_data();
+
+        // Source lines that are not aligned on a 16 bit boundary cannot be read in place and will be copied.
+        vector<uint8_t> unaligned_buffer(image_data.size() + 1);
+        std::copy(image_data.cbegin(), image_data.cend(), unaligned_buffer.begin() + 1);
+
+        jpegls_encoder encoder;
+        encoder.frame_info({static_cast<uint32_t>(reference_file.width()), static_cast<uint32_t>(reference_file.height()),
+                            reference_file.bits_per_sample(), reference_file.component_count()});
+
+        vector<uint8_t> encoded_aligned(encoder.estimated_destination_size());
+        encoder.destination(encoded_aligned);
+        encoded_aligned.resize(encoder.encode(image_data));
+
+        jpegls_encoder encoder_unaligned;
+        encoder_unaligned.frame_info({static_cast<uint32_t>(reference_file.width()), static_cast<uint32_t>(reference_file.height()),
+                                      reference_file.bits_per_sample(), reference_file.component_count()});
+
+        vector<uint8_t> encoded_unaligned(encoder_unaligned.estimated_destination_size());
+        encoder_unaligned.destination(encoded_unaligned);
+        encoded_unaligned.resize(encoder_unaligned.encode(unaligned_buffer.data() + 1, image_data.size()));
+
+        Assert::IsTrue(encoded_aligned == encoded_unaligned);
+    }
+
+    TEST_METHOD(encode_runs_interrupted_at_every_position) // NOLINT
+    {
+        // Every line has a run that is interrupted one pixel later than in the line above.
+        constexpr uint32_t width{100};
+        constexpr uint32_t height{width};
+        vector<uint8_t> source(static_cast<size_t>(width) * height * 3 * 2);
+        for (uint32_t line = 0; line < height; ++line)
+        {
+            source[(static_cast<size_t>(line) * width + line) * 3 * 2 + 1] = 1;
+        }
+
+        for (const auto mode : {interleave_mode::none, interleave_mode::sample})
+        {
+            jpegls_encoder encoder;
+            encoder.frame_info({width, height, 16, 3}).interleave_mode(mode);
+
+            vector<uint8_t> encoded(encoder.estimated_destination_size());
+            encoder.destination(encoded);
+            encoded.resize(encoder.encode(source));
+
+            vector<uint8_t> destination;
+            jpegls_decoder::decode(encoded, destination);
+
+            Assert::IsTrue(source == destination);
+        }
+    }
+
 private:
     static void encode(const char* filename, const interleave_mode interleave_mode = interleave_mode::none)
     {
@@ -7,6 +7,7 @@
 
 #include <charls/charls.h>
 
+#include <algorithm>
 #include <array>
 #include <tuple>
 #include <vector>
@@ -209,6 +210,33 @@ TEST_CLASS(jpegls_decoder_test)
         }
     }
 
+    TEST_METHOD(decode_reference_file_from_segments) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+
+        // Segments of 3 bytes (with empty segments in between) split markers, scans and stuffed bits.
+        vector<buffer_segment> segments;
+        for (size_t i = 0; i < source.size(); i += 3)
+        {
+            segments.push_back({source.data() + i, std::min(size_t{3}, source.size() - i)});
+            segments.push_back({source.data() + i, 0});
+        }
+
+        jpegls_decoder decoder;
+        decoder.source_segments(segments).read_header();
+
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+
+        portable_anymap_file reference_file = read_anymap_reference_file("DataFiles/TEST8.PPM", decoder.interleave_mode(), decoder.frame_info());
+
+        const auto& reference_image_data = reference_file.image_data();
+        for (size_t i = 0; i < destination.size(); ++i)
+        {
+            Assert::AreEqual(reference_image_data[i], destination[i]);
+        }
+    }
+
     TEST_METHOD(decode_with_default_pc_parameters_before_each_sos) // NOLINT
     {
         vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
@@ -339,6 +367,145 @@ TEST_CLASS(jpegls_decoder_test)
             [&] { static_cast<void>(decoder.read_header()); });
     }
 
+    TEST_METHOD(probe) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C1E3.JLS")};
+
+        const probe_info info{jpegls_decoder::probe(source)};
+
+        Assert::AreEqual(256U, info.frame_info.width);
+        Assert::AreEqual(256U, info.frame_info.height);
+        Assert::AreEqual(8, info.frame_info.bits_per_sample);
+        Assert::AreEqual(3, info.frame_info.component_count);
+        Assert::AreEqual(3, info.near_lossless);
+        Assert::IsTrue(interleave_mode::line == info.interleave_mode);
+        Assert::IsTrue(color_transformation::none == info.color_transformation);
+    }
+
+    TEST_METHOD(probe_header_prefix) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+        const vector<uint8_t> header_prefix(source.cbegin(), source.cbegin() + 100);
+
+        const probe_info info{jpegls_decoder::probe(header_prefix)};
+
+        Assert::AreEqual(256U, info.frame_info.width);
+        Assert::AreEqual(3, info.frame_info.component_count);
+        Assert::IsTrue(interleave_mode::none == info.interleave_mode);
+    }
+
+    TEST_METHOD(probe_too_small_header_prefix) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+
+        assert_expect_exception(jpegls_errc::source_buffer_too_small,
+            [&] { static_cast<void>(jpegls_decoder::probe(source.data(), 20)); });
+    }
+
+    TEST_METHOD(probe_non_jpegls_data) // NOLINT
+    {
+        const vector<uint8_t> source(100);
+
+        assert_expect_exception(jpegls_errc::jpeg_marker_start_byte_not_found,
+            [&] { static_cast<void>(jpegls_decoder::probe(source)); });
+    }
+
+    TEST_METHOD(decode_with_workspace) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C1E0.JLS")};
+        const probe_info info{jpegls_decoder::probe(source)};
+        vector<uint8_t> workspace(jpegls_decoder::workspace_size(info.frame_info, info.interleave_mode));
+
+        jpegls_decoder decoder{source};
+        decoder.read_header();
+        decoder.workspace(workspace.data(), workspace.size());
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+
+        portable_anymap_file reference_file = read_anymap_reference_file("DataFiles/TEST8.PPM", decoder.interleave_mode(), decoder.frame_info());
+
+        const auto& reference_image_data = reference_file.image_data();
+        for (size_t i = 0; i < destination.size(); ++i)
+        {
+            Assert::AreEqual(reference_image_data[i], destination[i]);
+        }
+    }
+
+    TEST_METHOD(decode_with_too_small_workspace) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C1E3.JLS")};
+        const probe_info info{jpegls_decoder::probe(source)};
+        vector<uint8_t> workspace(jpegls_decoder::workspace_size(info.frame_info, info.interleave_mode) - 1);
+
+        jpegls_decoder decoder{source};
+        decoder.read_header();
+        decoder.workspace(workspace.data(), workspace.size());
+        vector<uint8_t> destination(decoder.destination_size());
+
+        assert_expect_exception(jpegls_errc::not_enough_memory,
+            [&] { decoder.decode(destination); });
+    }
+
+    TEST_METHOD(workspace_size_with_invalid_frame_info) // NOLINT
+    {
+        assert_expect_exception(jpegls_errc::invalid_argument_bits_per_sample,
+            [] { static_cast<void>(jpegls_decoder::workspace_size({256, 256, 17, 1}, interleave_mode::none)); });
+    }
+
+    TEST_METHOD(scan_statistics_without_collecting) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+
+        jpegls_decoder decoder{source};
+        decoder.read_header();
+        assert_expect_exception(jpegls_errc::invalid_operation, [&decoder] { std::ignore = decoder.scan_statistics(); });
+
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+        assert_expect_exception(jpegls_errc::invalid_operation, [&decoder] { std::ignore = decoder.scan_statistics(); });
+    }
+
+    TEST_METHOD(scan_statistics_with_invalid_scan_index) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+
+        jpegls_decoder decoder{source};
+        decoder.read_header().collect_scan_statistics();
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+
+        std::ignore = decoder.scan_statistics(2);
+        assert_expect_exception(jpegls_errc::invalid_argument, [&decoder] { std::ignore = decoder.scan_statistics(3); });
+        assert_expect_exception(jpegls_errc::invalid_argument, [&decoder] { std::ignore = decoder.scan_statistics(-1); });
+    }
+
+    TEST_METHOD(timing_statistics) // NOLINT
+    {
+        const vector<uint8_t> source{read_file("DataFiles/T8C0E0.JLS")};
+
+        jpegls_decoder decoder{source};
+        decoder.read_header();
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+
+        charls::timing_statistics timing;
+        try
+        {
+            timing = decoder.timing_statistics();
+        }
+        catch (const jpegls_error& error)
+        {
+            // The library is built without the CHARLS_TIMING option.
+            Assert::IsTrue(jpegls_errc::invalid_operation == error.code());
+            return;
+        }
+
+        Assert::IsTrue(timing.read_header_nanoseconds > 0);
+        Assert::IsTrue(timing.create_codec_nanoseconds > 0);
+        Assert::IsTrue(timing.process_line_nanoseconds > 0);
+        Assert::IsTrue(timing.scan_nanoseconds >= timing.process_line_nanoseconds);
+    }
+
     TEST_METHOD(simple_decode) // NOLINT
     {
         const vector<uint8_t> encoded_source{read_file("DataFiles/T8C0E0.JLS")};
@@ -396,6 +563,29 @@ TEST_CLASS(jpegls_decoder_test)
             [&] { static_cast<void>(decoder.decode(destination)); });
     }
 
+    TEST_METHOD(decode_image_with_long_runs) // NOLINT
+    {
+        // Runs that end at the end of the line and runs that are interrupted after more than 16 run continuation bits.
+        constexpr uint32_t width{4096};
+        constexpr uint32_t height{4};
+        vector<uint8_t> source(static_cast<size_t>(width) * height, 7);
+        source[width + 3000] = 9;
+        source[2 * width + 17] = 9;
+        source[3 * width + width - 1] = 9;
+
+        jpegls_encoder encoder;
+        encoder.frame_info({width, height, 8, 1});
+
+        vector<uint8_t> encoded(encoder.estimated_destination_size());
+        encoder.destination(encoded);
+        encoded.resize(encoder.encode(source));
+
+        vector<uint8_t> destination;
+        jpegls_decoder::decode(encoded, destination);
+
+        Assert::IsTrue(source == destination);
+    }
+
 private:
     static vector<uint8_t>::iterator find_scan_header(const vector<uint8_t>::iterator& begin, const vector<uint8_t>::iterator& end)
     {
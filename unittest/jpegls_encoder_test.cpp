@@ -8,7 +8,10 @@
 #include "../src/jpeg_marker_code.h"
 #include <charls/charls.h>
 
+#include <algorithm>
 #include <array>
+#include <iterator>
+#include <tuple>
 #include <vector>
 
 using Microsoft::VisualStudio::CppUnitTestFramework::Assert;
@@ -517,6 +520,143 @@ TEST_CLASS(jpegls_encoder_test)
         test_by_decoding(destination, frame_info, source.data(), source.size(), interleave_mode::none);
     }
 
+    TEST_METHOD(encode_pipelined) // NOLINT
+    {
+        // Use enough pixels to fill several symbol batches of the pipeline.
+        const frame_info frame_info{512, 256, 8, 1};
+        const vector<uint8_t> source{create_noise_image_8_bit(static_cast<size_t>(frame_info.width) * frame_info.height, 6, 1)};
+
+        const auto expected = jpegls_encoder::encode(source, frame_info);
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info).pipelined_encoding();
+        vector<uint8_t> destination(encoder.estimated_destination_size());
+        encoder.destination(destination);
+        destination.resize(encoder.encode(source));
+
+        Assert::IsTrue(expected == destination);
+    }
+
+    TEST_METHOD(encode_to_destination_handler) // NOLINT
+    {
+        const frame_info frame_info{512, 256, 8, 1};
+        const vector<uint8_t> source{create_noise_image_8_bit(static_cast<size_t>(frame_info.width) * frame_info.height, 6, 1)};
+
+        const auto expected = jpegls_encoder::encode(source, frame_info);
+
+        // Blocks of 1000 bytes, to split the header and the scan at arbitrary positions.
+        vector<vector<uint8_t>> blocks;
+        const auto next_block = [](void* user_context, size_t* size) -> void* {
+            auto& allocated_blocks = *static_cast<vector<vector<uint8_t>>*>(user_context);
+            allocated_blocks.emplace_back(1000);
+            *size = allocated_blocks.back().size();
+            return allocated_blocks.back().data();
+        };
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info).destination_handler(next_block, &blocks);
+        const size_t bytes_written{encoder.encode(source)};
+
+        Assert::AreEqual(expected.size(), bytes_written);
+        Assert::AreEqual((bytes_written + 999) / 1000, blocks.size());
+        vector<uint8_t> destination;
+        for (const auto& block : blocks)
+        {
+            destination.insert(destination.end(), block.begin(), block.begin() + static_cast<ptrdiff_t>(std::min(block.size(), bytes_written - destination.size())));
+        }
+        Assert::IsTrue(expected == destination);
+    }
+
+    TEST_METHOD(scan_statistics_match_decoder) // NOLINT
+    {
+        const array<charls::interleave_mode, 3> interleave_modes{interleave_mode::none, interleave_mode::line, interleave_mode::sample};
+        for (const auto interleave_mode : interleave_modes)
+        {
+            test_scan_statistics(interleave_mode, false);
+            test_scan_statistics(interleave_mode, true);
+        }
+    }
+
+    TEST_METHOD(scan_statistics_with_invalid_scan_index) // NOLINT
+    {
+        const frame_info frame_info{64, 32, 8, 1};
+        const auto source = create_runs_and_noise_image(frame_info);
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info).collect_scan_statistics();
+        vector<uint8_t> destination(encoder.estimated_destination_size());
+        encoder.destination(destination);
+        std::ignore = encoder.encode(source);
+
+        assert_expect_exception(jpegls_errc::invalid_argument, [&encoder] { std::ignore = encoder.scan_statistics(1); });
+        assert_expect_exception(jpegls_errc::invalid_argument, [&encoder] { std::ignore = encoder.scan_statistics(-1); });
+    }
+
+    TEST_METHOD(scan_statistics_without_collecting) // NOLINT
+    {
+        const frame_info frame_info{64, 32, 8, 1};
+        const auto source = create_runs_and_noise_image(frame_info);
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info);
+        assert_expect_exception(jpegls_errc::invalid_operation, [&encoder] { std::ignore = encoder.scan_statistics(); });
+
+        vector<uint8_t> destination(encoder.estimated_destination_size());
+        encoder.destination(destination);
+        std::ignore = encoder.encode(source);
+
+        assert_expect_exception(jpegls_errc::invalid_operation, [&encoder] { std::ignore = encoder.scan_statistics(); });
+    }
+
+    TEST_METHOD(timing_statistics_in_place_encode) // NOLINT
+    {
+        // Lossless 8 bit monochrome images are encoded directly from the source lines.
+        const frame_info frame_info{512, 256, 8, 1};
+        const auto source = create_runs_and_noise_image(frame_info);
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info);
+        vector<uint8_t> destination(encoder.estimated_destination_size());
+        encoder.destination(destination);
+        std::ignore = encoder.encode(source);
+
+        charls::timing_statistics timing;
+        try
+        {
+            timing = encoder.timing_statistics();
+        }
+        catch (const jpegls_error& error)
+        {
+            // The library is built without the CHARLS_TIMING option.
+            Assert::IsTrue(jpegls_errc::invalid_operation == error.code());
+            return;
+        }
+
+        Assert::AreEqual(uint64_t{}, timing.read_header_nanoseconds);
+        Assert::IsTrue(timing.create_codec_nanoseconds > 0);
+        Assert::IsTrue(timing.process_line_nanoseconds > 0);
+        Assert::IsTrue(timing.scan_nanoseconds >= timing.process_line_nanoseconds);
+    }
+
+    TEST_METHOD(auto_coding_parameters_color_image) // NOLINT
+    {
+        // The green component follows the red and blue components, a color transformation makes the image smaller.
+        const frame_info frame_info{128, 64, 8, 3};
+        const auto source = create_correlated_color_image(frame_info);
+
+        const auto encoded = test_auto_coding_parameters(source, frame_info, interleave_mode::sample);
+
+        Assert::IsTrue(color_transformation::none != jpegls_decoder::probe(encoded).color_transformation);
+    }
+
+    TEST_METHOD(auto_coding_parameters_monochrome_image) // NOLINT
+    {
+        const frame_info frame_info{128, 64, 8, 1};
+        const auto source = create_runs_and_noise_image(frame_info);
+
+        std::ignore = test_auto_coding_parameters(source, frame_info, interleave_mode::none);
+    }
+
     TEST_METHOD(simple_encode) // NOLINT
     {
         const vector<uint8_t> source{0, 1, 2, 3, 4, 5};
@@ -528,6 +668,119 @@ TEST_CLASS(jpegls_encoder_test)
     }
 
 private:
+    // Creates an image with runs in the left half and noise in the right half of every line, to use both coding modes.
+    static vector<uint8_t> create_runs_and_noise_image(const frame_info& frame_info, const charls::interleave_mode interleave_mode = interleave_mode::none)
+    {
+        vector<uint8_t> source{create_noise_image_8_bit(static_cast<size_t>(frame_info.width) * frame_info.height * static_cast<size_t>(frame_info.component_count), 8, 1)};
+        const size_t pixel_stride{interleave_mode == interleave_mode::sample ? static_cast<size_t>(frame_info.component_count) : 1U};
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            const size_t x = i / pixel_stride % frame_info.width;
+            if (x < frame_info.width / 2)
+            {
+                source[i] = static_cast<uint8_t>(x / 8 * 16); // NOLINT
+            }
+        }
+
+        return source;
+    }
+
+    // Creates an RGB image (sample interleaved) with a noisy ramp in the red and blue components and green close to them.
+    static vector<uint8_t> create_correlated_color_image(const frame_info& frame_info)
+    {
+        const size_t pixel_count{static_cast<size_t>(frame_info.width) * frame_info.height};
+        const vector<uint8_t> base_noise{create_noise_image_8_bit(pixel_count, 4, 1)};
+        const vector<uint8_t> green_noise{create_noise_image_8_bit(pixel_count, 2, 2)};
+        vector<uint8_t> source(pixel_count * 3);
+        for (size_t pixel = 0; pixel < pixel_count; ++pixel)
+        {
+            const auto base = static_cast<uint8_t>(pixel % frame_info.width + pixel / frame_info.width + base_noise[pixel]);
+            source[pixel * 3] = base;
+            source[pixel * 3 + 1] = static_cast<uint8_t>(base + green_noise[pixel]);
+            source[pixel * 3 + 2] = base;
+        }
+
+        return source;
+    }
+
+    // Encodes with automatic coding parameters, checks the image round-trips and that the stream contains the selected
+    // parameters: an explicit encode with the parameters found in the stream must create the same bytes.
+    static vector<uint8_t> test_auto_coding_parameters(const vector<uint8_t>& source, const frame_info& frame_info, const charls::interleave_mode interleave_mode)
+    {
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info).interleave_mode(interleave_mode).auto_coding_parameters();
+        vector<uint8_t> encoded(encoder.estimated_destination_size());
+        encoder.destination(encoded);
+        encoded.resize(encoder.encode(source));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded).read_header();
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+        Assert::IsTrue(source == destination);
+
+        jpegls_encoder explicit_encoder;
+        explicit_encoder.frame_info(frame_info)
+            .interleave_mode(interleave_mode)
+            .color_transformation(jpegls_decoder::probe(encoded).color_transformation)
+            .preset_coding_parameters(decoder.preset_coding_parameters());
+        vector<uint8_t> explicit_encoded(explicit_encoder.estimated_destination_size());
+        explicit_encoder.destination(explicit_encoded);
+        explicit_encoded.resize(explicit_encoder.encode(source));
+        Assert::IsTrue(encoded == explicit_encoded);
+
+        const auto default_encoded = jpegls_encoder::encode(source, frame_info, interleave_mode);
+        Assert::IsTrue(encoded.size() <= default_encoded.size());
+
+        return encoded;
+    }
+
+    static void test_scan_statistics(const charls::interleave_mode interleave_mode, const bool pipelined)
+    {
+        const frame_info frame_info{64, 32, 8, 3};
+        const auto source = create_runs_and_noise_image(frame_info, interleave_mode);
+
+        jpegls_encoder encoder;
+        encoder.frame_info(frame_info).interleave_mode(interleave_mode).pipelined_encoding(pipelined).collect_scan_statistics();
+        vector<uint8_t> encoded(encoder.estimated_destination_size());
+        encoder.destination(encoded);
+        encoded.resize(encoder.encode(source));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded).read_header().collect_scan_statistics();
+        vector<uint8_t> destination(decoder.destination_size());
+        decoder.decode(destination);
+        Assert::IsTrue(source == destination);
+
+        // In interleave mode sample a run interruption codes all the components of a pixel.
+        const int32_t scan_count{interleave_mode == interleave_mode::none ? frame_info.component_count : 1};
+        const uint64_t samples_per_interruption{interleave_mode == interleave_mode::sample ? static_cast<uint64_t>(frame_info.component_count) : 1U};
+        uint64_t sample_count{};
+        for (int32_t scan_index{}; scan_index < scan_count; ++scan_index)
+        {
+            const auto encoder_statistics = encoder.scan_statistics(scan_index);
+            const auto decoder_statistics = decoder.scan_statistics(scan_index);
+
+            Assert::IsTrue(encoder_statistics.regular_mode_sample_count > 0);
+            Assert::IsTrue(encoder_statistics.run_mode_sample_count > 0);
+            Assert::IsTrue(encoder_statistics.run_interruption_count > 0);
+            Assert::AreEqual(encoder_statistics.regular_mode_sample_count, decoder_statistics.regular_mode_sample_count);
+            Assert::AreEqual(encoder_statistics.run_mode_sample_count, decoder_statistics.run_mode_sample_count);
+            Assert::AreEqual(encoder_statistics.run_interruption_count, decoder_statistics.run_interruption_count);
+            Assert::AreEqual(encoder_statistics.escape_code_count, decoder_statistics.escape_code_count);
+            Assert::AreEqual(encoder_statistics.stuffed_bit_count, decoder_statistics.stuffed_bit_count);
+            Assert::AreEqual(encoder_statistics.context_reset_count, decoder_statistics.context_reset_count);
+            Assert::IsTrue(std::equal(std::begin(encoder_statistics.golomb_parameter_count), std::end(encoder_statistics.golomb_parameter_count),
+                                      std::begin(decoder_statistics.golomb_parameter_count)));
+
+            sample_count += encoder_statistics.regular_mode_sample_count + encoder_statistics.run_mode_sample_count +
+                            encoder_statistics.run_interruption_count * samples_per_interruption;
+        }
+
+        Assert::AreEqual(source.size(), static_cast<size_t>(sample_count));
+        assert_expect_exception(jpegls_errc::invalid_argument, [&decoder, scan_count] { std::ignore = decoder.scan_statistics(scan_count); });
+    }
+
     static void test_by_decoding(const vector<uint8_t>& encoded_source, const frame_info& source_frame_info, const uint8_t* source, const size_t source_size, const charls::interleave_mode interleave_mode)
     {
         jpegls_decoder decoder;
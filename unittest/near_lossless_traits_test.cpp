@@ -0,0 +1,149 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "pch.h"
+
+#include "util.h"
+
+#include "../src/default_traits.h"
+#include "../src/encoder_strategy.h"
+#include "../src/jpegls_preset_coding_parameters.h"
+#include "../src/near_lossless_traits.h"
+#include "../src/scan.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using Microsoft::VisualStudio::CppUnitTestFramework::Assert;
+using std::vector;
+
+namespace charls {
+namespace test {
+
+// clang-format off
+
+TEST_CLASS(near_lossless_traits_test)
+{
+public:
+    TEST_METHOD(test_traits_8_bit) // NOLINT
+    {
+        test_traits<uint8_t, 8, 1>();
+        test_traits<uint8_t, 8, 2>();
+        test_traits<uint8_t, 8, 3>();
+    }
+
+    TEST_METHOD(test_traits_16_bit) // NOLINT
+    {
+        test_traits<uint16_t, 16, 1>();
+        test_traits<uint16_t, 16, 2>();
+        test_traits<uint16_t, 16, 3>();
+    }
+
+    TEST_METHOD(encode_8_bit_matches_default_traits) // NOLINT
+    {
+        const vector<uint8_t> source{create_noise_image_8_bit(64 * 64, 5, 1)};
+
+        test_encode<uint8_t, 8, 1>(source);
+        test_encode<uint8_t, 8, 2>(source);
+        test_encode<uint8_t, 8, 3>(source);
+    }
+
+    TEST_METHOD(encode_16_bit_matches_default_traits) // NOLINT
+    {
+        vector<uint8_t> source(64 * 64 * 2);
+        const vector<uint8_t> noise{create_noise_image_8_bit(source.size(), 8, 1)};
+        for (size_t i = 0; i < source.size(); i += 2)
+        {
+            // Noise in the low byte and a slow ramp in the high byte: both the regular and the run mode are used.
+            source[i] = noise[i] < 64 ? 0 : noise[i];
+            source[i + 1] = static_cast<uint8_t>(i / 512);
+        }
+
+        test_encode<uint16_t, 16, 1>(source);
+        test_encode<uint16_t, 16, 2>(source);
+        test_encode<uint16_t, 16, 3>(source);
+    }
+
+private:
+    // The quantization and dequantization functions are private: they are checked with compute_error_value and
+    // compute_reconstructed_sample.
+    template<typename SampleType, int32_t BitsPerPixel, int32_t NearLossless>
+    static void test_traits()
+    {
+        using near_traits = near_lossless_traits<SampleType, BitsPerPixel, NearLossless>;
+        const default_traits<SampleType, SampleType> traits((1 << BitsPerPixel) - 1, NearLossless);
+
+        Assert::IsTrue(traits.maximum_sample_value == near_traits::maximum_sample_value);
+        Assert::IsTrue(traits.near_lossless == near_traits::near_lossless);
+        Assert::IsTrue(traits.range == near_traits::range);
+        Assert::IsTrue(traits.quantized_bits_per_pixel == near_traits::quantized_bits_per_pixel);
+        Assert::IsTrue(traits.bits_per_pixel == near_traits::bits_per_pixel);
+        Assert::IsTrue(traits.limit == near_traits::limit);
+        Assert::IsTrue(traits.reset_threshold == near_traits::reset_threshold);
+
+        const int32_t maximum_sample_value{near_traits::maximum_sample_value};
+        for (int32_t i = -maximum_sample_value; i <= maximum_sample_value; ++i)
+        {
+            if (traits.compute_error_value(i) != near_traits::compute_error_value(i)) // AreEqual is slow, pre-test to speed up
+            {
+                Assert::AreEqual(traits.compute_error_value(i), near_traits::compute_error_value(i));
+            }
+        }
+
+        for (int32_t i = -near_traits::range; i <= near_traits::range; ++i)
+        {
+            Assert::AreEqual(traits.modulo_range(i), near_traits::modulo_range(i));
+        }
+
+        for (int32_t i = -maximum_sample_value; i <= 2 * maximum_sample_value; ++i)
+        {
+            if (traits.correct_prediction(i) != near_traits::correct_prediction(i) || traits.is_near(i, 2) != near_traits::is_near(i, 2))
+            {
+                Assert::AreEqual(traits.correct_prediction(i), near_traits::correct_prediction(i));
+                Assert::IsTrue(traits.is_near(i, 2) == near_traits::is_near(i, 2));
+            }
+        }
+
+        // All error values for every 251th predicted value (a prime, to vary the low bits), and the last one.
+        for (int32_t predicted = 0; predicted <= maximum_sample_value; predicted = predicted == maximum_sample_value ? predicted + 1 : std::min(predicted + 251, maximum_sample_value))
+        {
+            for (int32_t error_value = -near_traits::range / 2; error_value <= (near_traits::range + 1) / 2 - 1; ++error_value)
+            {
+                if (traits.compute_reconstructed_sample(predicted, error_value) != near_traits::compute_reconstructed_sample(predicted, error_value))
+                {
+                    Assert::AreEqual(traits.compute_reconstructed_sample(predicted, error_value), near_traits::compute_reconstructed_sample(predicted, error_value));
+                }
+            }
+        }
+    }
+
+    // Encodes a 64 x 64 monochrome scan with the near-lossless traits and with default_traits: the bit streams must be identical.
+    template<typename SampleType, int32_t BitsPerPixel, int32_t NearLossless>
+    static void test_encode(const vector<uint8_t>& source)
+    {
+        const auto expected = encode_scan(default_traits<SampleType, SampleType>((1 << BitsPerPixel) - 1, NearLossless), BitsPerPixel, NearLossless, source);
+        const auto encoded = encode_scan(near_lossless_traits<SampleType, BitsPerPixel, NearLossless>(), BitsPerPixel, NearLossless, source);
+
+        Assert::IsTrue(expected == encoded);
+    }
+
+    template<typename Traits>
+    static vector<uint8_t> encode_scan(const Traits& traits, const int32_t bits_per_sample, const int32_t near_lossless, const vector<uint8_t>& source)
+    {
+        const frame_info frame_info{64, 64, bits_per_sample, 1};
+        jls_codec<Traits, encoder_strategy> codec{traits, frame_info, {near_lossless, interleave_mode::none, color_transformation::none, false}};
+        encoder_strategy& encoder{codec};
+        encoder.set_presets({});
+
+        vector<uint8_t> destination(source.size() * 2 + 1024);
+        byte_stream_info destination_info{from_byte_array(destination.data(), destination.size())};
+        std::unique_ptr<process_line> process_line{encoder.create_process_line(from_byte_array_const(source.data(), source.size()), frame_info.width * sizeof(typename Traits::sample_type))};
+        destination.resize(encoder.encode_scan(std::move(process_line), destination_info));
+
+        return destination;
+    }
+};
+
+} // namespace test
+} // namespace charls
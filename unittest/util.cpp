@@ -153,6 +153,21 @@ vector<uint8_t> create_test_spiff_header(const uint8_t high_version, const uint8
     return buffer;
 }
 
+vector<uint8_t> create_noise_image_8_bit(const size_t pixel_count, const int bit_count, const uint32_t seed)
+{
+    const auto max_value = static_cast<int>((1U << bit_count) - 1U);
+    mt19937 generator(seed);
+
+    MSVC_CONST uniform_int_distribution<int> distribution(0, max_value);
+
+    vector<uint8_t> buffer(pixel_count);
+    for (auto& sample : buffer)
+    {
+        sample = static_cast<uint8_t>(distribution(generator));
+    }
+    return buffer;
+}
+
 vector<uint8_t> create_noise_image_16_bit(const size_t pixel_count, const int bit_count, const uint32_t seed)
 {
     const auto max_value = static_cast<uint16_t>((1U << bit_count) - 1U);